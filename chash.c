@@ -0,0 +1,428 @@
+/*
+ * Concurrent hash table. This is a table of strings to pointers that many
+ * threads can use at the same time without a lock around it.
+ *
+ * The buckets are chains of nodes. Readers do not lock. They follow the
+ * chain with atomic loads, and a node is never changed after it is put in
+ * a chain, except for its link to the next node, so a reader always sees a
+ * whole node. Writers lock one of CHASH_STRIPES stripes, which is picked by
+ * the low bits of the hash, so writers of different keys rarely wait for
+ * each other.
+ *
+ * The table grows while it is in use. When a stripe has more entries than
+ * it has buckets, a new array of buckets that is twice the size is made.
+ * Every insert and remove after that moves the next CHASH_MIGRATE buckets
+ * to it, so no one writer moves the whole table. A bucket is moved by
+ * making copies of its nodes in the new array and then putting a FORWARD
+ * marker in the old bucket, which sends readers and writers to the new
+ * array. The old chain is not changed, so a reader that is in it while it
+ * is moved still sees all of it. The number of buckets is always a
+ * multiple of the number of stripes, so a bucket and the two buckets it
+ * moves to have the same stripe, and one lock covers all three.
+ *
+ * Removed nodes and old arrays are retired. When using the GC, they are
+ * dropped and the GC frees them when no thread can see them. Otherwise
+ * epochs are used, as in snaplist.c. Every operation records the epoch in
+ * a reader slot while it runs. A retired node gets the epoch that it was
+ * retired in and is freed once no reader slot holds an epoch that is not
+ * newer. A thread keeps using the same reader slot, so the slots are not
+ * fought over.
+ */
+#include "util.h"
+
+// Marks a bucket that has been moved to the next array.
+static _chash_node forward_node;
+#define FORWARD (&forward_node)
+
+#ifndef USE_GC
+// The reader slot that this thread used last time.
+static _Thread_local int reader_hint = 0;
+#endif
+
+static _chash_array* create_array(int cap) {
+
+    _chash_array* arr = _ALLOC(sizeof(_chash_array) + sizeof(_Atomic(_chash_node*)) * cap);
+    arr->cap = cap;
+    atomic_init(&arr->next, NULL);
+    atomic_init(&arr->migrate, 0);
+    atomic_init(&arr->moved, 0);
+    for(int i = 0; i < cap; i++)
+        atomic_init(&arr->buckets[i], NULL);
+
+    return arr;
+}
+
+static _chash_node* create_node(const char* key, uint32_t len, uint32_t hash, void* value) {
+
+    _chash_node* node = _ALLOC(sizeof(_chash_node) + len + 1);
+    atomic_init(&node->next, NULL);
+    node->value = value;
+    node->hash = hash;
+    node->len = len;
+    memcpy(node->key, key, len);
+    node->key[len] = '\0';
+
+    return node;
+}
+
+static inline _chash_stripe* get_stripe(CHashTable* tab, uint32_t hash) {
+
+    return &tab->stripes[hash & (CHASH_STRIPES - 1)];
+}
+
+// Record the epoch in a reader slot for as long as the operation runs.
+// Returns the slot.
+static int enter_table(CHashTable* tab) {
+
+#ifdef USE_GC
+    (void)tab;
+    return -1;
+#else
+    while(true) {
+        uint64_t epoch = atomic_load(&tab->epoch);
+        for(int i = 0; i < CHASH_READERS; i++) {
+            int slot = (reader_hint + i) & (CHASH_READERS - 1);
+            uint64_t expect = 0;
+            if(atomic_compare_exchange_strong(&tab->readers[slot].epoch, &expect, epoch)) {
+                reader_hint = slot;
+                return slot;
+            }
+        }
+        sched_yield(); // all reader slots are in use
+    }
+#endif
+}
+
+static void leave_table(CHashTable* tab, int slot) {
+
+#ifdef USE_GC
+    (void)tab;
+    (void)slot;
+#else
+    atomic_store_explicit(&tab->readers[slot].epoch, 0, memory_order_release);
+#endif
+}
+
+#ifndef USE_GC
+// Free every retired node and array in the stripe that no reader can still
+// be looking at. Called with the stripe lock held.
+static void reclaim_stripe(CHashTable* tab, _chash_stripe* stripe) {
+
+    uint64_t oldest = UINT64_MAX;
+
+    for(int i = 0; i < CHASH_READERS; i++) {
+        uint64_t val = atomic_load(&tab->readers[i].epoch);
+        if(val != 0 && val < oldest)
+            oldest = val;
+    }
+
+    _chash_garbage** ptr = &stripe->retired;
+    while(*ptr != NULL) {
+        _chash_garbage* g = *ptr;
+        if(g->retired < oldest) {
+            *ptr = g->next;
+            stripe->nretired--;
+            _FREE(g);
+        }
+        else
+            ptr = &g->next;
+    }
+}
+#endif
+
+// Retire a node or an array that has been taken out of the table. Called
+// with the stripe lock held.
+static void retire_garbage(CHashTable* tab, _chash_stripe* stripe, _chash_garbage* g) {
+
+#ifdef USE_GC
+    (void)tab;
+    (void)stripe;
+    (void)g;
+#else
+    g->retired = atomic_fetch_add(&tab->epoch, 1);
+    g->next = stripe->retired;
+    stripe->retired = g;
+    if(++stripe->nretired >= CHASH_RECLAIM)
+        reclaim_stripe(tab, stripe);
+#endif
+}
+
+// Follow the FORWARD markers to the array that has the bucket for the hash.
+static inline _chash_array* find_array(_chash_array* arr, uint32_t hash, _chash_node** head) {
+
+    while(true) {
+        *head = atomic_load_explicit(&arr->buckets[hash & (arr->cap - 1)], memory_order_acquire);
+        if(*head != FORWARD)
+            return arr;
+        arr = atomic_load_explicit(&arr->next, memory_order_acquire);
+    }
+}
+
+static inline bool node_equal(_chash_node* node, const char* key, uint32_t len, uint32_t hash) {
+
+    return node->hash == hash && node->len == len && memcmp(node->key, key, len) == 0;
+}
+
+// Start moving the buckets to an array that is twice the size. Only the
+// current array is resized, so the last move is finished first. Called with
+// a stripe lock held.
+static void start_resize(CHashTable* tab, _chash_array* arr) {
+
+    if(arr != atomic_load(&tab->array) || atomic_load(&arr->next) != NULL)
+        return;
+
+    _chash_array* next = create_array(arr->cap * 2);
+    _chash_array* expect = NULL;
+    if(!atomic_compare_exchange_strong(&arr->next, &expect, next))
+        _FREE(next); // another writer started it, and nobody has seen this one
+}
+
+// Move one bucket to the next array. The bucket and the two that it moves
+// to are all in the stripe, which is locked.
+static void move_bucket(CHashTable* tab, _chash_stripe* stripe, _chash_array* arr, int idx) {
+
+    _chash_array* next = atomic_load(&arr->next);
+    _chash_node* lo = NULL;
+    _chash_node* hi = NULL;
+    _chash_node* node = atomic_load_explicit(&arr->buckets[idx], memory_order_acquire);
+
+    while(node != NULL) {
+        _chash_node* copy = create_node(node->key, node->len, node->hash, node->value);
+        if(node->hash & arr->cap) {
+            atomic_init(&copy->next, hi);
+            hi = copy;
+        }
+        else {
+            atomic_init(&copy->next, lo);
+            lo = copy;
+        }
+        _chash_node* old = node;
+        node = atomic_load_explicit(&node->next, memory_order_acquire);
+        retire_garbage(tab, stripe, &old->garbage);
+    }
+
+    atomic_store_explicit(&next->buckets[idx], lo, memory_order_release);
+    atomic_store_explicit(&next->buckets[idx + arr->cap], hi, memory_order_release);
+    atomic_store_explicit(&arr->buckets[idx], FORWARD, memory_order_release);
+
+    // the last bucket to move makes the next array the current one
+    if(atomic_fetch_add(&arr->moved, 1) + 1 == arr->cap) {
+        atomic_store(&tab->array, next);
+        retire_garbage(tab, stripe, &arr->garbage);
+    }
+}
+
+// While the table is being resized, every writer moves a few buckets after
+// it is done with its own change. No stripe lock is held when this is
+// called.
+static void help_resize(CHashTable* tab) {
+
+    _chash_array* arr = atomic_load(&tab->array);
+    if(atomic_load(&arr->next) == NULL)
+        return;
+
+    int start = atomic_fetch_add(&arr->migrate, CHASH_MIGRATE);
+    int end = (start + CHASH_MIGRATE < arr->cap) ? start + CHASH_MIGRATE : arr->cap;
+
+    for(int i = start; i < end; i++) {
+        _chash_stripe* stripe = &tab->stripes[i & (CHASH_STRIPES - 1)];
+        pthread_mutex_lock(&stripe->lock);
+        move_bucket(tab, stripe, arr, i);
+        pthread_mutex_unlock(&stripe->lock);
+    }
+}
+
+static HashResult insert_key(CHashTable* tab, const char* key, uint32_t len, void* value) {
+
+    uint32_t hash = hash_bytes(key, len);
+    _chash_stripe* stripe = get_stripe(tab, hash);
+    HashResult res = HASH_OK;
+    int slot = enter_table(tab);
+
+    pthread_mutex_lock(&stripe->lock);
+
+    _chash_node* head;
+    _chash_array* arr = find_array(atomic_load(&tab->array), hash, &head);
+
+    for(_chash_node* node = head; node != NULL; node = atomic_load(&node->next)) {
+        if(node_equal(node, key, len, hash)) {
+            res = HASH_DUP;
+            break;
+        }
+    }
+
+    if(res == HASH_OK) {
+        _chash_node* node = create_node(key, len, hash, value);
+        atomic_init(&node->next, head);
+        atomic_store_explicit(&arr->buckets[hash & (arr->cap - 1)], node, memory_order_release);
+        if(atomic_fetch_add_explicit(&stripe->count, 1, memory_order_relaxed) + 1 >
+           arr->cap / CHASH_STRIPES)
+            start_resize(tab, arr);
+    }
+
+    pthread_mutex_unlock(&stripe->lock);
+
+    help_resize(tab);
+    leave_table(tab, slot);
+
+    return res;
+}
+
+static HashResult find_key(CHashTable* tab, const char* key, uint32_t len, void** value) {
+
+    uint32_t hash = hash_bytes(key, len);
+    HashResult res = HASH_NF;
+    int slot = enter_table(tab);
+
+    _chash_node* node;
+    find_array(atomic_load_explicit(&tab->array, memory_order_acquire), hash, &node);
+
+    for(; node != NULL; node = atomic_load_explicit(&node->next, memory_order_acquire)) {
+        if(node_equal(node, key, len, hash)) {
+            if(value != NULL)
+                *value = node->value;
+            res = HASH_OK;
+            break;
+        }
+    }
+
+    leave_table(tab, slot);
+
+    return res;
+}
+
+static HashResult remove_key(CHashTable* tab, const char* key, uint32_t len) {
+
+    uint32_t hash = hash_bytes(key, len);
+    _chash_stripe* stripe = get_stripe(tab, hash);
+    HashResult res = HASH_NF;
+    int slot = enter_table(tab);
+
+    pthread_mutex_lock(&stripe->lock);
+
+    _chash_node* head;
+    _chash_array* arr = find_array(atomic_load(&tab->array), hash, &head);
+    _Atomic(_chash_node*)* link = &arr->buckets[hash & (arr->cap - 1)];
+
+    for(_chash_node* node = head; node != NULL; node = atomic_load(&node->next)) {
+        if(node_equal(node, key, len, hash)) {
+            // the removed node still points to the rest of the chain for
+            // the readers that are in it
+            atomic_store_explicit(link, atomic_load(&node->next), memory_order_release);
+            atomic_fetch_sub_explicit(&stripe->count, 1, memory_order_relaxed);
+            retire_garbage(tab, stripe, &node->garbage);
+            res = HASH_OK;
+            break;
+        }
+        link = &node->next;
+    }
+
+    pthread_mutex_unlock(&stripe->lock);
+
+    help_resize(tab);
+    leave_table(tab, slot);
+
+    return res;
+}
+
+CHashTable* create_chashtable() {
+
+    CHashTable* tab = _ALLOC_T(CHashTable);
+
+    atomic_init(&tab->array, create_array(CHASH_STRIPES * 4));
+    atomic_init(&tab->epoch, 1);
+    for(int i = 0; i < CHASH_STRIPES; i++) {
+        pthread_mutex_init(&tab->stripes[i].lock, NULL);
+        atomic_init(&tab->stripes[i].count, 0);
+        tab->stripes[i].retired = NULL;
+        tab->stripes[i].nretired = 0;
+    }
+    for(int i = 0; i < CHASH_READERS; i++)
+        atomic_init(&tab->readers[i].epoch, 0);
+
+    return tab;
+}
+
+static void destroy_array(_chash_array* arr) {
+
+    for(int i = 0; i < arr->cap; i++) {
+        _chash_node* node = atomic_load(&arr->buckets[i]);
+        if(node == FORWARD)
+            continue;
+        while(node != NULL) {
+            _chash_node* next = atomic_load(&node->next);
+            _FREE(node);
+            node = next;
+        }
+    }
+    _FREE(arr);
+}
+
+// No other thread can be using the table when it is destroyed.
+void destroy_chashtable(CHashTable* tab) {
+
+    if(tab != NULL) {
+        _chash_array* arr = atomic_load(&tab->array);
+        _chash_array* next = atomic_load(&arr->next);
+        destroy_array(arr);
+        if(next != NULL)
+            destroy_array(next);
+
+        for(int i = 0; i < CHASH_STRIPES; i++) {
+            _chash_garbage* g = tab->stripes[i].retired;
+            while(g != NULL) {
+                _chash_garbage* next = g->next;
+                _FREE(g);
+                g = next;
+            }
+            pthread_mutex_destroy(&tab->stripes[i].lock);
+        }
+        _FREE(tab);
+    }
+}
+
+// Add the key with the value, which is kept as it is given. Returns
+// HASH_DUP, and does not change the value, if the key is already there.
+HashResult insert_chashtable(CHashTable* tab, const char* key, void* value) {
+
+    return insert_key(tab, key, strlen(key), value);
+}
+
+// Set value to the value for the key. It is not changed if the key is not
+// found.
+HashResult find_chashtable(CHashTable* tab, const char* key, void** value) {
+
+    return find_key(tab, key, strlen(key), value);
+}
+
+HashResult remove_chashtable(CHashTable* tab, const char* key) {
+
+    return remove_key(tab, key, strlen(key));
+}
+
+HashResult insert_chashtable_view(CHashTable* tab, StrView key, void* value) {
+
+    return insert_key(tab, key.ptr, key.len, value);
+}
+
+HashResult find_chashtable_view(CHashTable* tab, StrView key, void** value) {
+
+    return find_key(tab, key.ptr, key.len, value);
+}
+
+HashResult remove_chashtable_view(CHashTable* tab, StrView key) {
+
+    return remove_key(tab, key.ptr, key.len);
+}
+
+// The number of keys. While other threads are changing the table this is
+// only a close count.
+int count_chashtable(CHashTable* tab) {
+
+    int count = 0;
+
+    for(int i = 0; i < CHASH_STRIPES; i++)
+        count += atomic_load_explicit(&tab->stripes[i].count, memory_order_relaxed);
+
+    return count;
+}
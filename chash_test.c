@@ -0,0 +1,98 @@
+
+#ifdef USE_GC
+// threads that allocate must be known to the GC
+#define GC_THREADS
+#include <gc.h>
+#endif
+
+#include "util.h"
+
+#define NUM_THREADS 8
+#define NUM_KEYS 20000
+#define NUM_SHARED 1000
+
+static CHashTable* tab;
+
+#define VAL(n) ((void*)(intptr_t)(n))
+
+// Every thread adds its own keys, reads them and the shared keys back, then
+// removes half of its keys. The table grows many times while they run.
+void* worker(void* arg) {
+
+    int id = (int)(intptr_t)arg;
+    long errors = 0;
+    char key[64];
+    void* value;
+
+    for(int i = 0; i < NUM_KEYS; i++) {
+        snprintf(key, sizeof(key), "thread_%d_key_%d", id, i);
+        if(insert_chashtable(tab, key, VAL(i)) != HASH_OK)
+            errors++;
+
+        snprintf(key, sizeof(key), "shared_%d", i % NUM_SHARED);
+        if(find_chashtable(tab, key, &value) != HASH_OK || value != VAL(i % NUM_SHARED))
+            errors++;
+    }
+
+    for(int i = 0; i < NUM_KEYS; i++) {
+        snprintf(key, sizeof(key), "thread_%d_key_%d", id, i);
+        if(find_chashtable(tab, key, &value) != HASH_OK || value != VAL(i))
+            errors++;
+        if(i & 1 && remove_chashtable(tab, key) != HASH_OK)
+            errors++;
+    }
+
+    for(int i = 0; i < NUM_KEYS; i++) {
+        snprintf(key, sizeof(key), "thread_%d_key_%d", id, i);
+        if(find_chashtable(tab, key, &value) != ((i & 1) ? HASH_NF : HASH_OK))
+            errors++;
+    }
+
+    return (void*)errors;
+}
+
+int main() {
+
+    pthread_t threads[NUM_THREADS];
+    char key[64];
+    void* value = NULL;
+
+    tab = create_chashtable();
+
+    printf("single threaded\n");
+    printf("insert: %d\n", insert_chashtable(tab, "abc", VAL(1)));
+    printf("insert dup: %d\n", insert_chashtable(tab, "abc", VAL(2)));
+    printf("find: %d ", find_chashtable(tab, "abc", &value));
+    printf("value: %d\n", (int)(intptr_t)value);
+    printf("find view: %d\n", find_chashtable_view(tab, view_bytes("abcdef", 3), NULL));
+    printf("insert view: %d\n", insert_chashtable_view(tab, view_bytes("defghi", 3), VAL(3)));
+    printf("find missing: %d\n", find_chashtable(tab, "xyz", &value));
+    printf("count: %d\n", count_chashtable(tab));
+    printf("remove: %d\n", remove_chashtable(tab, "abc"));
+    printf("remove again: %d\n", remove_chashtable(tab, "abc"));
+    printf("remove view: %d\n", remove_chashtable_view(tab, view_bytes("def", 3)));
+    printf("count: %d\n\n", count_chashtable(tab));
+
+    for(int i = 0; i < NUM_SHARED; i++) {
+        snprintf(key, sizeof(key), "shared_%d", i);
+        insert_chashtable(tab, key, VAL(i));
+    }
+
+    printf("start %d threads\n", NUM_THREADS);
+    for(int i = 0; i < NUM_THREADS; i++)
+        pthread_create(&threads[i], NULL, worker, VAL(i));
+
+    long errors = 0;
+    for(int i = 0; i < NUM_THREADS; i++) {
+        void* res;
+        pthread_join(threads[i], &res);
+        errors += (long)res;
+    }
+
+    printf("errors: %ld\n", errors);
+    printf("count: %d expect: %d\n", count_chashtable(tab), NUM_SHARED + NUM_THREADS * NUM_KEYS / 2);
+
+    destroy_chashtable(tab);
+
+    return 0;
+}
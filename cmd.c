@@ -22,6 +22,11 @@ typedef struct {
     bool bval;
 } CmdItem;
 
+// Integers on the command line are decimal, or hex with a "0x" prefix. The
+// values are checked with the same base that the get functions read them
+// with.
+#define CMD_BASE 0
+
 typedef PtrList CmdItemList;
 typedef PtrListIter CmdItemListIter;
 
@@ -86,6 +91,8 @@ static void add_ci_list(CmdItemList* h, CmdItem* ptr) {
 
 typedef struct {
     CmdItemList* table;
+    PerfectHash* names; // index of the items by name, while parsing
+    PerfectHash* parms; // index of the items by parm, while parsing
     const char* desc;
     const char* fname;
     char** line;
@@ -158,6 +165,40 @@ static void show_error(Cmd* ptr, const char* fmt, ...) {
     exit(1);
 }
 
+// The options do not change once the command line is parsed, so a perfect
+// hash of them is built for the lookups. Adding an option drops it.
+static void build_index(Cmd* ptr) {
+
+    int count = length_list(ptr->table);
+    CmdItem** items = raw_list(ptr->table);
+    const char** names = _ALLOC_ARRAY(const char*, count);
+    const char** parms = _ALLOC_ARRAY(const char*, count);
+
+    for(int i = 0; i < count; i++) {
+        names[i] = items[i]->name;
+        parms[i] = items[i]->parm;
+    }
+
+    ptr->names = create_perfect_hash(names, count);
+    ptr->parms = create_perfect_hash(parms, count);
+
+    _FREE(names);
+    _FREE(parms);
+}
+
+static void drop_index(Cmd* ptr) {
+
+    destroy_perfect_hash(ptr->names);
+    destroy_perfect_hash(ptr->parms);
+    ptr->names = NULL;
+    ptr->parms = NULL;
+}
+
+static CmdItem* index_item(Cmd* ptr, int index) {
+
+    return (index < 0) ? NULL : ((CmdItem**)raw_list(ptr->table))[index];
+}
+
 // find exact name
 static CmdItem* find_by_name(Cmd* ptr, const char* name) {
 
@@ -166,6 +207,9 @@ static CmdItem* find_by_name(Cmd* ptr, const char* name) {
 
     CmdItem* ci;
 
+    if(ptr->names != NULL)
+        return index_item(ptr, find_perfect_hash(ptr->names, name));
+
     CmdItemListIter* cili = init_ci_list_iter(ptr->table);
     while(NULL != (ci = iterate_ci_list(cili))) {
         if(!strcmp(ci->name, name))
@@ -183,6 +227,11 @@ static CmdItem* find_by_parm(Cmd* ptr, const char* parm) {
     CmdItem *ci, *crnt = NULL;
     int len = 0, max = 0, plen = strlen(parm);
 
+    // an exact match is the longest match there can be, so only a parm that
+    // has its value joined to it needs the scan
+    if(ptr->parms != NULL && (ci = index_item(ptr, find_perfect_hash(ptr->parms, parm))) != NULL)
+        return ci;
+
     CmdItemListIter* cili = init_ci_list_iter(ptr->table);
     while(NULL != (ci = iterate_ci_list(cili))) {
         len = strlen(ci->parm);
@@ -237,6 +286,14 @@ static void save_cmd(Cmd* cmd, CmdItem* ci, const char* str) {
 // Future enhancement: Support commas to create a list in a single parameter.
 // for example: -x=123,abc,qwe,238 would be a list of 4 items connected to -x
 #endif
+        // numbers are checked here, so the get functions do not have to
+        long ival;
+        double fval;
+        if(ci->flag & CMD_INT && parse_int_view(view_str(str), CMD_BASE, &ival) != NUM_OK)
+            show_error(cmd, "invalid integer value for \"%s\": \"%s\"", ci->parm, str);
+        else if(ci->flag & CMD_FLOAT && parse_double_view(view_str(str), &fval) != NUM_OK)
+            show_error(cmd, "invalid number value for \"%s\": \"%s\"", ci->parm, str);
+
         add_string_list(ci->list, create_string(str));
     }
     else
@@ -321,6 +378,8 @@ CmdLine create_cmd_line(const char* description) {
     ptr->desc = _DUP_STR(description);
     ptr->fname = NULL;
     ptr->table = create_ci_list();
+    ptr->names = NULL;
+    ptr->parms = NULL;
     ptr->index = 0;
     ptr->max_args = 0;
 
@@ -335,6 +394,7 @@ void destroy_cmd_line(CmdLine cl) {
         if(ptr->fname != NULL)
             _FREE(ptr->fname);
         destroy_ci_list(ptr->table);
+        drop_index(ptr);
         _FREE(ptr);
     }
 }
@@ -376,6 +436,7 @@ void add_cmd(CmdLine cl,
         ci->bval = false;
 
     add_ci_list(cmd->table, ci);
+    drop_index(cmd);
 }
 
 Str* get_cmd_str(CmdLine cl, const char* name) {
@@ -388,25 +449,46 @@ Str* get_cmd_str(CmdLine cl, const char* name) {
     return peek_string_list(ci->list);
 }
 
+// A value that is not a number is shown as an error, the same way that a
+// bad value is when the command line is parsed.
+static void number_error(CmdLine cl, const char* name, const char* type, Str* str) {
+
+    Cmd* cmd = (Cmd*)cl;
+    show_error(cmd, "invalid %s value for \"%s\": \"%s\"", type, find_by_name(cmd, name)->parm,
+               raw_string(str));
+}
+
 long int get_cmd_int(CmdLine cl, const char* name) {
 
-    Str* s = get_cmd_str(cl, name);
+    long val = 0;
+    Str* str = get_cmd_str(cl, name);
 
-    return strtol(raw_string(s), NULL, 10);
+    if(parse_int_view(view_Str(str), CMD_BASE, &val) != NUM_OK)
+        number_error(cl, name, "integer", str);
+
+    return val;
 }
 
 unsigned long int get_cmd_unsigned(CmdLine cl, const char* name) {
 
-    Str* s = get_cmd_str(cl, name);
+    unsigned long val = 0;
+    Str* str = get_cmd_str(cl, name);
+
+    if(parse_uint_view(view_Str(str), CMD_BASE, &val) != NUM_OK)
+        number_error(cl, name, "unsigned integer", str);
 
-    return strtol(raw_string(s), NULL, 16);
+    return val;
 }
 
 double get_cmd_float(CmdLine cl, const char* name) {
 
-    Str* s = get_cmd_str(cl, name);
+    double val = 0;
+    Str* str = get_cmd_str(cl, name);
+
+    if(parse_double_view(view_Str(str), &val) != NUM_OK)
+        number_error(cl, name, "number", str);
 
-    return strtod(raw_string(s), NULL);
+    return val;
 }
 
 bool get_cmd_bool(CmdLine cl, const char* name) {
@@ -447,6 +529,8 @@ void parse_cmd_line(CmdLine cl, int argc, char** argv) {
     cmd->line = argv;
     cmd->max_args = argc;
     cmd->index = 1;
+    drop_index(cmd);
+    build_index(cmd);
     consume_token(cmd); // prime the pump
 
     while(get_token(cmd) != NULL) {
@@ -11,6 +11,7 @@ int main(int argc, char** argv) {
     add_cmd(cmd, "--pla", "pla", "Zoom zoom eats glue.", "blubbs", CMD_STR);
     add_cmd(cmd, "-glue-blue", "blue", "When the clock strikes 12.", NULL, CMD_NONE | CMD_LIST);
     add_cmd(cmd, "-v", "verbo", "Set the verbosity level.", "10", CMD_INT);
+    add_cmd(cmd, "-n", "count", "Set the count, in decimal or hex.", "0x10", CMD_INT);
     add_cmd(cmd, "-x", "ecks", "Set the ecks flag.", NULL, CMD_BOOL);
     add_cmd(cmd, "", "bang", "When bangarang meets the planderflip, there will be trouble.",
                 NULL, CMD_REQD | CMD_LIST);
@@ -20,6 +21,7 @@ int main(int argc, char** argv) {
     dump_cmd_line(cmd);
 
     printf("verbosity is %ld\n", get_cmd_int(cmd, "verbo"));
+    printf("count is %ld (unsigned %lu)\n", get_cmd_int(cmd, "count"), get_cmd_unsigned(cmd, "count"));
 
     return 0;
 }
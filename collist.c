@@ -0,0 +1,107 @@
+/*
+ * Column list. A record is described by a schema of fields, and each
+ * field is stored in its own List. Row N of the table is element N of
+ * every column. Scans that only need one field can walk a single
+ * contiguous array with raw_col_list() instead of copying whole records.
+ *
+ * All of the row operations are applied to every column, so the columns
+ * always have the same length.
+ */
+#include "util.h"
+
+static inline void check_column(ColList* lst, int col) {
+
+    if(col < 0 || col >= lst->ncols)
+        RAISE(LIST_ERROR, "List Error: column out of range: %d", col);
+}
+
+ColList* create_col_list(const ColField* fields, int count) {
+
+    assert(fields != NULL);
+    assert(count > 0);
+
+    ColList* ptr = _ALLOC_T(ColList);
+    ptr->ncols = count;
+    ptr->fields = _DUP_MEM_ARRAY((void*)fields, ColField, count);
+    ptr->cols = _ALLOC_ARRAY(List*, count);
+
+    for(int i = 0; i < count; i++)
+        ptr->cols[i] = create_list(fields[i].size);
+
+    return ptr;
+}
+
+void destroy_col_list(ColList* lst) {
+
+    if(lst != NULL) {
+        for(int i = 0; i < lst->ncols; i++)
+            destroy_list(lst->cols[i]);
+        _FREE(lst->cols);
+        _FREE(lst->fields);
+        _FREE(lst);
+    }
+}
+
+// Scatter the fields of the record into the columns.
+void append_col_list(ColList* lst, void* record) {
+
+    unsigned char* rec = (unsigned char*)record;
+
+    for(int i = 0; i < lst->ncols; i++)
+        append_list(lst->cols[i], &rec[lst->fields[i].offset]);
+}
+
+// Gather the fields of a row into the record.
+void read_col_list(ColList* lst, int index, void* record) {
+
+    unsigned char* rec = (unsigned char*)record;
+
+    for(int i = 0; i < lst->ncols; i++)
+        read_list(lst->cols[i], index, &rec[lst->fields[i].offset]);
+}
+
+void write_col_list(ColList* lst, int index, void* record) {
+
+    unsigned char* rec = (unsigned char*)record;
+
+    for(int i = 0; i < lst->ncols; i++)
+        write_list(lst->cols[i], index, &rec[lst->fields[i].offset]);
+}
+
+void delete_col_list(ColList* lst, int index) {
+
+    for(int i = 0; i < lst->ncols; i++)
+        delete_list(lst->cols[i], index);
+}
+
+void clear_col_list(ColList* lst) {
+
+    for(int i = 0; i < lst->ncols; i++)
+        clear_list(lst->cols[i]);
+}
+
+// Read a single field without touching the other columns.
+void read_col_field(ColList* lst, int index, int col, void* data) {
+
+    check_column(lst, col);
+    read_list(lst->cols[col], index, data);
+}
+
+void write_col_field(ColList* lst, int index, int col, void* data) {
+
+    check_column(lst, col);
+    write_list(lst->cols[col], index, data);
+}
+
+// Get the raw array for one column. The pointer is invalidated by any
+// operation that adds rows to the list.
+void* raw_col_list(ColList* lst, int col) {
+
+    check_column(lst, col);
+    return raw_list(lst->cols[col]);
+}
+
+int length_col_list(ColList* lst) {
+
+    return length_list(lst->cols[0]);
+}
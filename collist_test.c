@@ -0,0 +1,77 @@
+
+#include "util.h"
+
+typedef struct {
+    int id;
+    double price;
+    char tag[8];
+    short qty;
+} Record;
+
+static const ColField schema[] = {
+    COL_FIELD(Record, id),
+    COL_FIELD(Record, price),
+    COL_FIELD(Record, tag),
+    COL_FIELD(Record, qty),
+};
+
+void dump(ColList* lst) {
+
+    Record rec;
+
+    printf("rows: %d\n", length_col_list(lst));
+    for(int i = 0; i < length_col_list(lst); i++) {
+        read_col_list(lst, i, &rec);
+        printf("%3d. id: %d price: %.2f tag: %s qty: %d\n", i, rec.id, rec.price,
+               rec.tag, rec.qty);
+    }
+    printf("\n");
+}
+
+int main() {
+
+    ColList* lst = create_col_list(schema, sizeof(schema) / sizeof(schema[0]));
+    Record rec;
+
+    printf("add 12 records\n");
+    for(int i = 0; i < 12; i++) {
+        rec.id = 100 + i;
+        rec.price = i * 1.25;
+        snprintf(rec.tag, sizeof(rec.tag), "t%d", i);
+        rec.qty = (short)(i * 3);
+        append_col_list(lst, &rec);
+    }
+    dump(lst);
+
+    printf("sum of the price column\n");
+    double* prices = raw_col_list(lst, 1);
+    double sum = 0.0;
+    for(int i = 0; i < length_col_list(lst); i++)
+        sum += prices[i];
+    printf("sum: %.2f\n\n", sum);
+
+    printf("delete rows 0, 5 and the last one\n");
+    delete_col_list(lst, 0);
+    delete_col_list(lst, 5);
+    delete_col_list(lst, length_col_list(lst) - 1);
+    dump(lst);
+
+    printf("write the qty of row 2\n");
+    short qty = 999;
+    write_col_field(lst, 2, 3, &qty);
+    qty = 0;
+    read_col_field(lst, 2, 3, &qty);
+    printf("qty: %d\n\n", qty);
+
+    printf("overwrite row 0\n");
+    rec.id = 1;
+    rec.price = 0.5;
+    strcpy(rec.tag, "first");
+    rec.qty = 7;
+    write_col_list(lst, 0, &rec);
+    dump(lst);
+
+    destroy_col_list(lst);
+
+    return 0;
+}
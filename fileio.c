@@ -32,6 +32,9 @@ struct _file_ptr_ {
 };
 
 static struct _file_ptr_* file_stack = NULL;
+static bool utf8_columns = false;
+
+#define UTF8_BLOCK 4096
 
 /**
  * @brief Close the file on the top of the stack and pop it off of the stack,
@@ -105,15 +108,19 @@ int consume_char() {
     if(file_stack != NULL) {
         if(file_stack->ch == END_OF_FILE)
             return END_OF_FILE;
-        else if(file_stack->ch == '\n') {
+
+        // note that END_OF_FILE is equal to EOF
+        int ch = file_stack->ch;
+        file_stack->ch = fgetc(file_stack->fp);
+
+        if(ch == '\n') {
             file_stack->line_no++;
             file_stack->col_no = 1;
         }
-        else
+        // a continuation byte is in the same column as the byte before it
+        else if(!utf8_columns || (file_stack->ch & 0xC0) != 0x80)
             file_stack->col_no++;
 
-        // note that END_OF_FILE is equal to EOF
-        file_stack->ch = fgetc(file_stack->fp);
         return file_stack->ch;
     }
     else
@@ -161,6 +168,51 @@ const char* get_fname() {
         return NULL;
 }
 
+/**
+ * @brief Count columns in code points instead of bytes. This is off by
+ * default. Only bytes with the high bit set cost anything extra.
+ *
+ * @param flag
+ */
+void set_utf8_columns(bool flag) {
+
+    utf8_columns = flag;
+}
+
+/**
+ * @brief Return true if the whole file is valid UTF-8. The file is read in
+ * blocks and a sequence that is cut off at the end of a block is finished
+ * with the start of the next one.
+ *
+ * @param fname
+ * @return bool
+ */
+bool valid_utf8_file(const char* fname) {
+
+    FILE* fp = fopen(fname, "r");
+    if(fp == NULL)
+        RAISE(FILE_ERROR, "File Error: cannot open input file: %s: %s\n", fname,
+              strerror(errno));
+
+    char buf[UTF8_BLOCK + 4];
+    int have = 0;
+    size_t size;
+
+    while((size = fread(&buf[have], 1, UTF8_BLOCK, fp)) > 0) {
+        int len = have + size;
+        int valid = valid_utf8_prefix(view_bytes(buf, len));
+
+        have = len - valid;
+        if(have > 0 && have >= length_utf8_char(buf[valid]))
+            break; // not valid, the whole sequence is here
+
+        memmove(buf, &buf[valid], have);
+    }
+
+    fclose(fp);
+    return have == 0;
+}
+
 FPTR open_output_file(const char* fname) {
 
     struct _file_ptr_* ptr = _ALLOC_T(struct _file_ptr_);
@@ -204,7 +256,7 @@ void emit_fmt(FPTR h, const char* fmt, ...) {
 void emit_Str(FPTR h, Str* str) {
 
     struct _file_ptr_* ptr = (struct _file_ptr_*)h;
-    fprintf(ptr->fp, "%s", raw_string(str));
+    fwrite(raw_string(str), 1, length_string(str), ptr->fp);
 }
 
 void emit_str(FPTR h, const char* str) {
@@ -212,3 +264,9 @@ void emit_str(FPTR h, const char* str) {
     struct _file_ptr_* ptr = (struct _file_ptr_*)h;
     fprintf(ptr->fp, "%s", str);
 }
+
+void emit_view(FPTR h, StrView str) {
+
+    struct _file_ptr_* ptr = (struct _file_ptr_*)h;
+    fwrite(str.ptr, 1, str.len, ptr->fp);
+}
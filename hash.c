@@ -1,27 +1,54 @@
 
 /*
+ * Hash table with open addressing, in the style of the SwissTable.
  *
- *  https://programming.guide/hash-tables-open-addressing.html
+ *  https://abseil.io/about/design/swisstables
  *
- * The hash table uses linear probing where the probing distance is
- * hash & 0x0F. If the result is 0 then the distance is 1. When a hash
- * is deleted, the memory is freed and the tombstone flag is set. When
- * a hash is added, it can be added to a bucket which is a tombstone.
+ * The buckets are a flat array of entries and there is a separate array of
+ * one control byte per bucket. A control byte is EMPTY, DELETED or, for a
+ * bucket that is in use, the low 7 bits of the hash of its key. A probe
+ * loads a group of 16 control bytes and compares all of them to the 7 bits
+ * that it wants with one SSE2 compare, so only the buckets that match are
+ * looked at, and the key is only compared when the whole hash matches. A
+ * group with an EMPTY byte ends the probe. The groups are visited with a
+ * triangular sequence, which visits every group once because the number of
+ * buckets is a power of 2.
  *
- * The table is full when 3/4 of the buckets are in use. The table is
- * resized and all of the existing hashes are rehashed into the new table.
+ * The first 16 control bytes are copied after the last one, so a group can
+ * be loaded at any bucket without wrapping around.
  *
- * The add function tracks the max number of hops that are needed to
- * insert a new hash. If the hops exceed a certain number, then the hash
- * table should be rehashed, but only if a certain number of adds have
- * taken place to avoid performance problems.
+ * A removed entry leaves a DELETED marker so that probes carry on past it.
+ * An insert uses the first EMPTY or DELETED bucket in its probe.
  *
- * Maybe tombstones should be counted instead of hops, but I do not
- * anticipate needing to delete a lot of entries. Rehashing deletes
- * tombstones.
+ * When 7/8 of the buckets are in use or deleted, a new set of buckets is
+ * made. It is twice the size, or the same size when no more than half of
+ * the buckets hold entries, which cleans out the deleted ones. The entries
+ * are not all moved at once. Every insert and remove after that moves the
+ * next HASH_MIGRATE buckets, and lookups look in the new buckets and then
+ * in the old ones until all of them have been moved. That way no one
+ * insert has to move the whole table.
  *
- * Test build string:
- * clang -Wall -Wextra -DTEST -g -o t hash_examp.c memory.c
+ * Lookups never write to the table, so they are safe from more than one
+ * thread as long as nothing is being added or removed.
+ *
+ * The key and the data are copied into one allocation, so an insert makes
+ * one allocation and a probe does not follow a pointer until the hash
+ * matches. A table that is made with HASH_STORE_PTR keeps the data pointer
+ * that it is given, and one that is made with HASH_STORE_INLINE copies a
+ * value that is no bigger than a pointer into the entry itself, so neither
+ * one copies the data into the allocation for the key.
+ *
+ * lookup_hashtable() returns a pointer to the stored value instead of a
+ * copy, and upsert_hashtable() finds the key or adds it with one probe.
+ *
+ * Keys are strings, or any bytes with a length, unless the table is made
+ * with HASH_KEY_INT. Then the keys are 64 bit integers or pointers, which
+ * are kept in the entry in place of the pointer to the key.
+ *
+ * The hash is seeded with a random number for every run. A table that is
+ * made with HASH_SEED hashes its string keys with a seed of its own, so keys
+ * that collide in one table do not collide in another, even when the seed
+ * for the run is set with set_hash_seed().
  */
 
 #include <assert.h>
@@ -30,179 +57,1171 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#ifdef __linux__
+#include <sys/random.h>
+#endif
 
 #include "util.h"
 
+// The keys are hashed with wyhash, which reads the key 8 or 16 bytes at a
+// time and mixes with 64 bit multiplies, so it is much faster than a byte
+// at a time hash on keys that are longer than a few bytes.
+//
+//  https://github.com/wangyi-fudan/wyhash
+//
+// The seed is random for every run of the program, so someone who picks the
+// keys, such as file names or command line strings, cannot pick ones that
+// all land in the same bucket. A program that needs the same hashes every
+// time, such as a test, can set the seed with set_hash_seed() before it
+// hashes anything.
+static const uint64_t wy_secret[4] = {
+    0xa0761d6478bd642full,
+    0xe7037ed1a0b428dbull,
+    0x8ebc6af09c88c6e3ull,
+    0x589965cc75374cc3ull,
+};
+
+// 0 means the seed has not been picked yet.
+static uint64_t hash_seed = 0;
+static uint64_t table_seeds = 0;
+
+// Multiply to 128 bits and return the two halves.
+static inline void wy_mum(uint64_t* a, uint64_t* b) {
+
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t wy_mix(uint64_t a, uint64_t b) {
+
+    wy_mum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t wy_r8(const uint8_t* p) {
+
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t wy_r4(const uint8_t* p) {
+
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// 1 to 3 bytes.
+static inline uint64_t wy_r3(const uint8_t* p, size_t len) {
+
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+}
+
+// Get some bits that are different for every run of the program. The
+// random number from the system is used if there is one, and the time and
+// the addresses, which move with ASLR, are used otherwise.
+static uint64_t random_seed(void) {
+
+    uint64_t seed = 0;
+
+#ifdef __linux__
+    if(getrandom(&seed, sizeof(seed), GRND_NONBLOCK) != sizeof(seed))
+        seed = 0;
+#endif
+    if(seed == 0) {
+        seed = wy_mix((uint64_t)time(NULL) ^ wy_secret[0], (uint64_t)clock() ^ wy_secret[1]);
+        seed = wy_mix(seed ^ (uintptr_t)&seed, (uintptr_t)&random_seed ^ wy_secret[2]);
+    }
+
+    return (seed != 0) ? seed : wy_secret[3];
+}
 
-static uint32_t hash_func(const char* key) {
+// Return the seed, and pick it the first time. Two threads that both pick
+// one agree on the first one that was stored.
+static inline uint64_t get_seed(void) {
 
-    uint32_t hash = 2166136261u;
-    int slen = strlen(key);
+    uint64_t seed = __atomic_load_n(&hash_seed, __ATOMIC_ACQUIRE);
 
-    for(int i = 0; i < slen; i++) {
-        hash ^= (uint8_t)key[i];
-        hash *= 16777619;
+    if(seed == 0) {
+        uint64_t expect = 0;
+        seed = random_seed();
+        if(!__atomic_compare_exchange_n(&hash_seed, &expect, seed, false, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE))
+            seed = expect;
     }
 
-    return hash;
+    return seed;
+}
+
+// Set the seed for hash_bytes(). This has to be done before anything is
+// hashed, because the hashes that are kept in tables and strings are not
+// changed. A seed of 0 picks a new random one.
+void set_hash_seed(uint64_t seed) {
+
+    __atomic_store_n(&hash_seed, (seed != 0) ? seed : random_seed(), __ATOMIC_RELEASE);
+}
+
+uint64_t get_hash_seed(void) {
+
+    return get_seed();
+}
+
+// Set the 0x20 bit of every ASCII capital letter in the bytes of the word,
+// with the same test as case_block() in str.c. Every byte is tested on its
+// own, so this works for the words that are put together from 3 or 4 bytes.
+static inline uint64_t wy_fold(uint64_t w) {
+
+    const uint64_t ones = 0x0101010101010101ull;
+    const uint64_t high = 0x8080808080808080ull;
+    uint64_t low = w & ~high;
+    uint64_t mask = ((low + (0x80 - 'A') * ones) & ~(low + (0x80 - 'Z' - 1) * ones) & ~w) & high;
+
+    return w | (mask >> 2);
 }
 
-static int find_slot(HashTable* tab, const char* key) {
+// wyhash. When fold is set, the words are lower cased as they are read, so
+// there is no lower case copy of the key. This is always inlined, so the
+// two versions are compiled without the test.
+static inline __attribute__((always_inline)) uint64_t wy_hash(const uint8_t* p, size_t len,
+                                                              uint64_t seed, bool fold) {
 
-    uint32_t hash = hash_func(key) & (tab->cap - 1);
-    int inc = hash & 0x0F;
-    inc = (inc == 0) ? 1 : inc;
+#define WY_R8(p) (fold ? wy_fold(wy_r8(p)) : wy_r8(p))
+#define WY_R4(p) (fold ? wy_fold(wy_r4(p)) : wy_r4(p))
+    uint64_t a, b;
 
-    if(tab->table[hash] == NULL) {
-        tab->count++;
-        return hash;
+    seed ^= wy_mix(seed ^ wy_secret[0], wy_secret[1]);
+
+    if(len <= 16) {
+        if(len >= 4) {
+            size_t mid = (len >> 3) << 2;
+            a = (WY_R4(p) << 32) | WY_R4(p + mid);
+            b = (WY_R4(p + len - 4) << 32) | WY_R4(p + len - 4 - mid);
+        }
+        else if(len > 0) {
+            a = fold ? wy_fold(wy_r3(p, len)) : wy_r3(p, len);
+            b = 0;
+        }
+        else
+            a = b = 0;
     }
     else {
-        do {
-            for(int i = 0; i < tab->cap; i++) {
-                if(tab->table[hash] == NULL) {
-                    tab->count++;
-                    return hash;
-                }
-                else if(tab->table[hash]->key == NULL) {
-                    tab->tombstones--;
-                    tab->count++;
-                    return hash;
-                }
-                else if(strcmp(tab->table[hash]->key, key) == 0) {
-                    return hash; // duplicate key
-                }
-                else
-                    hash = (hash + inc) & (tab->cap - 1);
-            }
-            inc = 1; // slot not found
-        } while(true);
-    }
-
-    return -1; // keep the compiler happy
+        size_t i = len;
+        if(i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wy_mix(WY_R8(p) ^ wy_secret[1], WY_R8(p + 8) ^ seed);
+                see1 = wy_mix(WY_R8(p + 16) ^ wy_secret[2], WY_R8(p + 24) ^ see1);
+                see2 = wy_mix(WY_R8(p + 32) ^ wy_secret[3], WY_R8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while(i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while(i > 16) {
+            seed = wy_mix(WY_R8(p) ^ wy_secret[1], WY_R8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = WY_R8(p + i - 16);
+        b = WY_R8(p + i - 8);
+    }
+#undef WY_R8
+#undef WY_R4
+
+    a ^= wy_secret[1];
+    b ^= seed;
+    wy_mum(&a, &b);
+
+    return wy_mix(a ^ wy_secret[0] ^ len, b ^ wy_secret[1]);
 }
 
-static void rehash_table(HashTable* tab) {
+// The 64 bit hash of a buffer with the seed that is given.
+uint64_t hash_bytes64(const void* key, size_t len, uint64_t seed) {
+
+    return wy_hash((const uint8_t*)key, len, seed, false);
+}
+
+// The hash of a buffer with the seed for this run, folded to 32 bits. This
+// is public so that other modules can cache the hash of a key.
+uint32_t hash_bytes(const void* key, size_t len) {
+
+    uint64_t hash = wy_hash((const uint8_t*)key, len, get_seed(), false);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+// Same as hash_bytes(), but the ASCII letters are hashed as lower case, so
+// keys that only differ in case have the same hash.
+uint32_t hash_bytes_nocase(const void* key, size_t len) {
+
+    uint64_t hash = wy_hash((const uint8_t*)key, len, get_seed(), true);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+// Mix the bits of an integer key, so that keys that only differ in a few
+// bits, such as counters and aligned pointers, spread out over the table.
+// This is the finalizer of MurmurHash3.
+static inline uint32_t hash_num(uint64_t key) {
+
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+
+    return (uint32_t)key;
+}
+
+// Control bytes. A bucket that is in use has the low 7 bits of its hash,
+// so the high bit is only set for EMPTY and DELETED.
+#define CTRL_EMPTY ((uint8_t)0x80)
+#define CTRL_DELETED ((uint8_t)0xFE)
+
+// Keys are copied into the front of the allocation for the entry, and the
+// data goes after the key, lined up for any type.
+#define DATA_ALIGN sizeof(max_align_t)
+
+static inline uint8_t hash_h2(uint32_t hash) {
+
+    return hash & 0x7F;
+}
+
+static inline uint32_t hash_h1(uint32_t hash) {
+
+    return hash >> 7;
+}
+
+static inline bool is_full(uint8_t ctrl) {
+
+    return (ctrl & 0x80) == 0;
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+// Return a bit for every byte of the group that is equal to ch.
+static inline unsigned match_group(const uint8_t* ctrl, uint8_t ch) {
+
+    __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(ch)));
+}
+
+// Return a bit for every byte that is EMPTY or DELETED.
+static inline unsigned match_free(const uint8_t* ctrl) {
+
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+}
+#else
+static inline unsigned match_group(const uint8_t* ctrl, uint8_t ch) {
+
+    unsigned mask = 0;
+    for(int i = 0; i < HASH_GROUP; i++)
+        mask |= (unsigned)(ctrl[i] == ch) << i;
+
+    return mask;
+}
+
+static inline unsigned match_free(const uint8_t* ctrl) {
+
+    unsigned mask = 0;
+    for(int i = 0; i < HASH_GROUP; i++)
+        mask |= (unsigned)(ctrl[i] >> 7) << i;
+
+    return mask;
+}
+#endif
+
+// Set the control byte and the copy of it past the end of the array.
+static inline void set_ctrl(_hash_buckets* b, int slot, uint8_t ch) {
+
+    b->ctrl[slot] = ch;
+    if(slot < HASH_GROUP)
+        b->ctrl[b->cap + slot] = ch;
+}
+
+// A removed entry in the list of a HASH_ORDERED table.
+#define HOLE_LEN UINT32_MAX
+
+// Return the entry for a bucket that is in use. A HASH_ORDERED table keeps
+// the entries in a list in the order they were added, and the buckets have
+// the index of the entry in the list.
+static inline _hash_entry* bucket_entry(HashTable* tab, _hash_buckets* b, int slot) {
+
+    if(b->index != NULL)
+        return &((_hash_entry*)raw_list(tab->order))[b->index[slot]];
+    else
+        return &b->entries[slot];
+}
+
+// A key as the probe sees it. A string key is the characters and their
+// length, an integer key is the number. The hash is for either one.
+typedef struct {
+    const char* str;
+    size_t len;
+    uint64_t num;
+    uint32_t hash;
+} _hash_key;
+
+// The functions that take a num flag are inlined into one copy for string
+// keys and one copy for integer keys, so each copy compares keys the one
+// way that it needs to and the flag is gone after the compile.
+static inline bool entry_equal(_hash_entry* entry, const _hash_key* k, bool num) {
+
+    if(num)
+        return entry->num == k->num;
+    else
+        return entry->hash == k->hash && entry->len == k->len &&
+               memcmp(entry->key, k->str, k->len) == 0;
+}
+
+// Return the bucket that holds the key or -1 if it is not in the buckets.
+// This does not write anything, so lookups can be done by more than one
+// thread at a time as long as nothing is being added or removed.
+//
+// If free is not NULL and the key is not found, it is set to the first
+// EMPTY or DELETED bucket in the probe, so an insert does not have to
+// probe again. If groups is not NULL, it counts the groups that are looked
+// at, for probe_stats_hashtable().
+static inline int probe_groups(HashTable* tab, _hash_buckets* b, const _hash_key* k, bool num,
+                               int* free, int* groups) {
 
-    if(tab->count * 1.75 > tab->cap) {
-        int oldcap = tab->cap;
-        _hash_node** oldtab = tab->table;
-        tab->cap <<= 1; // double the capacity
-        tab->tombstones = 0;
-        tab->count = 0;
-        tab->table = _ALLOC_ARRAY(_hash_node*, tab->cap);
-        for(int i = 0; i < tab->cap; i++)
-            tab->table[i] = NULL;
-
-        int slot;
-
-        for(int i = 0; i < oldcap; i++) {
-            if(oldtab[i] != NULL && oldtab[i]->key != NULL) {
-                slot = find_slot(tab, oldtab[i]->key);
-                tab->table[slot] = oldtab[i];
-            }
+    int mask = b->cap - 1;
+    int pos = hash_h1(k->hash) & mask;
+    uint8_t h2 = hash_h2(k->hash);
+
+    if(free != NULL)
+        *free = -1;
+
+    for(int step = HASH_GROUP; step <= b->cap; step += HASH_GROUP) {
+        const uint8_t* group = &b->ctrl[pos];
+
+        if(groups != NULL)
+            (*groups)++;
+
+        for(unsigned bits = match_group(group, h2); bits != 0; bits &= bits - 1) {
+            int slot = (pos + __builtin_ctz(bits)) & mask;
+            if(entry_equal(bucket_entry(tab, b, slot), k, num))
+                return slot;
+        }
+
+        if(free != NULL && *free < 0) {
+            unsigned bits = match_free(group);
+            if(bits != 0)
+                *free = (pos + __builtin_ctz(bits)) & mask;
+        }
+
+        if(match_group(group, CTRL_EMPTY) != 0)
+            return -1; // the end of the chain
+
+        pos = (pos + step) & mask;
+    }
+
+    return -1;
+}
+
+static inline int probe_slot(HashTable* tab, _hash_buckets* b, const _hash_key* k, bool num,
+                             int* free) {
+
+    return probe_groups(tab, b, k, num, free, NULL);
+}
+
+// Return the first EMPTY or DELETED bucket in the probe for the hash. The
+// buckets are never full, so there always is one.
+static int find_free_slot(_hash_buckets* b, uint32_t hash) {
+
+    int mask = b->cap - 1;
+    int pos = hash_h1(hash) & mask;
+
+    for(int step = HASH_GROUP;; step += HASH_GROUP) {
+        unsigned bits = match_free(&b->ctrl[pos]);
+        if(bits != 0)
+            return (pos + __builtin_ctz(bits)) & mask;
+
+        pos = (pos + step) & mask;
+    }
+}
+
+static void alloc_buckets(HashTable* tab, _hash_buckets* b, int cap) {
+
+    b->cap = cap;
+    b->ctrl = _ALLOC(cap + HASH_GROUP);
+    memset(b->ctrl, CTRL_EMPTY, cap + HASH_GROUP);
+    if(tab->flags & HASH_ORDERED) {
+        b->entries = NULL;
+        b->index = _ALLOC_ARRAY(int32_t, cap);
+    }
+    else {
+        b->entries = _ALLOC_ARRAY(_hash_entry, cap);
+        b->index = NULL;
+    }
+}
+
+static inline bool is_migrating(HashTable* tab) {
+
+    return tab->old.ctrl != NULL;
+}
+
+// Move up to count buckets from the old buckets into the current ones.
+// The entries are moved, the keys and the data stay where they are. A moved
+// bucket is marked DELETED in the old buckets, so a key that is removed
+// after it was moved is not found there again.
+static void migrate_table(HashTable* tab, int count) {
+
+    _hash_buckets* old = &tab->old;
+    int end = tab->migrate + count;
+    if(end > old->cap)
+        end = old->cap;
+
+    for(int i = tab->migrate; i < end; i++) {
+        if(is_full(old->ctrl[i])) {
+            int slot = find_free_slot(&tab->cur, old->entries[i].hash);
+            tab->cur.entries[slot] = old->entries[i];
+            set_ctrl(&tab->cur, slot, old->ctrl[i]);
+            set_ctrl(old, i, CTRL_DELETED);
+            tab->old_count--;
         }
-        _FREE(oldtab);
     }
+    tab->migrate = end;
+
+    if(tab->migrate >= old->cap) {
+        _FREE(old->ctrl);
+        _FREE(old->entries);
+        old->ctrl = NULL;
+        old->entries = NULL;
+        old->cap = 0;
+    }
+}
+
+// When the current buckets are 7/8 used, counting the deleted ones, new
+// buckets are made and the entries are moved over a few at a time by the
+// inserts and removes that follow. If no more than half of the buckets hold
+// entries, the rest are mostly deleted, so the new buckets are the same size,
+// which cleans out the deleted markers. Otherwise the size is doubled.
+// A HASH_ORDERED table does not move its entries, only the indexes in the
+// buckets. When the list and the deleted buckets fill 7/8 of the buckets,
+// the removed entries are taken out of the list and the buckets are made
+// again from the list, all at once. That is one pass over the list, which
+// is in one block of memory.
+static void rebuild_order(HashTable* tab) {
+
+    int used = length_list(tab->order);
+    if((used + 1) * 8 <= tab->cur.cap * 7)
+        return;
+
+    int cap = tab->cur.cap;
+    if(tab->count * 2 > cap)
+        cap <<= 1;
+
+    _hash_entry* list = raw_list(tab->order);
+    int len = 0;
+    for(int i = 0; i < used; i++) {
+        if(list[i].len != HOLE_LEN)
+            list[len++] = list[i];
+    }
+    tab->order->len = len * tab->order->size;
+
+    _FREE(tab->cur.ctrl);
+    _FREE(tab->cur.index);
+    alloc_buckets(tab, &tab->cur, cap);
+    tab->tombstones = 0;
+
+    for(int i = 0; i < len; i++) {
+        int slot = find_free_slot(&tab->cur, list[i].hash);
+        tab->cur.index[slot] = i;
+        set_ctrl(&tab->cur, slot, hash_h2(list[i].hash));
+    }
+}
+
+static void rehash_table(HashTable* tab) {
+
+    if(tab->flags & HASH_ORDERED) {
+        rebuild_order(tab);
+        return;
+    }
+
+    if(is_migrating(tab))
+        migrate_table(tab, HASH_MIGRATE);
+
+    int used = tab->count - tab->old_count + tab->tombstones;
+    if((used + 1) * 8 <= tab->cur.cap * 7)
+        return;
+
+    // the last move did not finish in time, which only happens if HASH_MIGRATE
+    // is set too low. Finish it before starting another.
+    if(is_migrating(tab))
+        migrate_table(tab, tab->old.cap);
+
+    int cap = tab->cur.cap;
+    if(tab->count * 2 > cap)
+        cap <<= 1;
+
+    tab->old = tab->cur;
+    tab->old_count = tab->count;
+    tab->migrate = 0;
+    tab->tombstones = 0;
+    alloc_buckets(tab, &tab->cur, cap);
+    migrate_table(tab, HASH_MIGRATE);
 }
 
 HashTable* create_hashtable() {
 
-    HashTable* tab = _ALLOC_T(HashTable);
+    return create_hashtable_flags(HASH_STORE_COPY);
+}
+
+// The flags select how the data is stored and what the keys are. See
+// HashFlag.
+HashTable* create_hashtable_flags(HashFlag flags) {
 
+    assert(!((flags & HASH_KEY_INT) && (flags & HASH_KEY_BORROW)));
+
+    HashTable* tab = _ALLOC_T(HashTable);
+    tab->flags = flags;
+    tab->order = (flags & HASH_ORDERED) ? create_list(sizeof(_hash_entry)) : NULL;
+    alloc_buckets(tab, &tab->cur, HASH_GROUP);
+    tab->old.ctrl = NULL;
+    tab->old.entries = NULL;
+    tab->old.index = NULL;
+    tab->old.cap = 0;
+    tab->migrate = 0;
+    tab->old_count = 0;
     tab->count = 0;
-    tab->cap = 0x01 << 3;
+    tab->tombstones = 0;
 
-    tab->table = _ALLOC_ARRAY(_hash_node*, tab->cap);
-    for(int i = 0; i < tab->cap; i++)
-        tab->table[i] = NULL;
+    // every table gets its own seed from the seed for the run
+    if(flags & HASH_SEED)
+        tab->seed = wy_mix(get_seed() ^ __atomic_add_fetch(&table_seeds, 1, __ATOMIC_RELAXED),
+                           wy_secret[2]);
+    else
+        tab->seed = get_seed();
 
     return tab;
 }
 
-void destroy_hashtable(HashTable* table) {
+// Free what the table allocated for the entry.
+static void free_entry(HashTable* tab, _hash_entry* entry) {
 
-    if(table != NULL) {
-        for(int i = 0; i < table->cap; i++) {
-            if(table->table[i] != NULL) {
-                if(table->table[i]->key != NULL) {
-                    _FREE(table->table[i]->key);
-                    _FREE(table->table[i]->data);
-                }
-            }
-            _FREE(table->table[i]);
+    if(!(tab->flags & (HASH_KEY_INT | HASH_KEY_BORROW)))
+        _FREE(entry->key); // the copy of the data is in the same allocation
+    else if((tab->flags & HASH_STORE_MASK) == HASH_STORE_COPY && entry->data != NULL)
+        _FREE(entry->data);
+}
+
+static void destroy_buckets(HashTable* tab, _hash_buckets* b) {
+
+    if(b->ctrl != NULL) {
+        for(int i = 0; i < b->cap; i++) {
+            if(is_full(b->ctrl[i]))
+                free_entry(tab, bucket_entry(tab, b, i));
         }
+        _FREE(b->ctrl);
+        if(b->entries != NULL)
+            _FREE(b->entries);
+        if(b->index != NULL)
+            _FREE(b->index);
+    }
+}
+
+void destroy_hashtable(HashTable* table) {
 
-        _FREE(table->table);
+    if(table != NULL) {
+        destroy_buckets(table, &table->cur);
+        destroy_buckets(table, &table->old);
+        if(table->order != NULL)
+            destroy_list(table->order);
         _FREE(table);
     }
 }
 
-HashResult insert_hashtable(HashTable* table, const char* key, void* data, size_t size) {
+// Find the key in either set of buckets. Returns the slot, or -1, and sets
+// b to the buckets that hold it.
+static inline int find_entry(HashTable* tab, const _hash_key* k, bool num, _hash_buckets** b) {
 
-    rehash_table(table);
+    *b = &tab->cur;
+    int slot = probe_slot(tab, *b, k, num, NULL);
 
-    int slot = find_slot(table, key);
-    if(slot < 0)
-        return false;
+    if(slot < 0 && is_migrating(tab)) {
+        *b = &tab->old;
+        slot = probe_slot(tab, *b, k, num, NULL);
+    }
 
-    // help me, obi wan optimizer, you are my only hope
-    if(table->table[slot] != NULL) {
-        if(table->table[slot]->key != NULL) {
-            // printf("cannot store duplicate key: \"%s\"\n", key);
-            return HASH_DUP;
-        }
+    return slot;
+}
+
+// Return a pointer to where the value of the entry is stored.
+static inline void* entry_value(HashTable* tab, _hash_entry* entry) {
+
+    return ((tab->flags & HASH_STORE_MASK) == HASH_STORE_INLINE) ? entry->value : entry->data;
+}
+
+// Fill in the entry for a new key in the free bucket of the current ones.
+static _hash_entry* add_entry(HashTable* tab, int slot, const _hash_key* k, void* data,
+                              size_t size) {
+
+    HashFlag store = tab->flags & HASH_STORE_MASK;
+    _hash_entry* entry;
+
+    if(tab->flags & HASH_ORDERED) {
+        // the entry goes at the end of the list
+        _hash_entry blank = { 0 };
+        tab->cur.index[slot] = length_list(tab->order);
+        append_list(tab->order, &blank);
+        entry = bucket_entry(tab, &tab->cur, slot);
     }
     else
-        table->table[slot] = _ALLOC_T(_hash_node);
+        entry = &tab->cur.entries[slot];
+
+    if(tab->cur.ctrl[slot] == CTRL_DELETED)
+        tab->tombstones--;
+    tab->count++;
+
+    if(data == NULL)
+        size = 0;
 
-    table->table[slot]->key = _DUP_STR(key);
-    if(data != NULL && size != 0) {
-        table->table[slot]->data = _ALLOC(size);
-        table->table[slot]->size = size;
-        memcpy(table->table[slot]->data, data, size);
+    // an integer key is kept in the entry and a borrowed key is kept as the
+    // pointer, so only a copy of the data is allocated. A string key has the
+    // copy of the data after it.
+    char* buf = NULL;
+    if(tab->flags & (HASH_KEY_INT | HASH_KEY_BORROW)) {
+        if(tab->flags & HASH_KEY_INT)
+            entry->num = k->num;
+        else
+            entry->key = k->str;
+        if(store == HASH_STORE_COPY && size != 0)
+            buf = _ALLOC(size);
     }
     else {
-        table->table[slot]->data = NULL;
-        table->table[slot]->size = 0;
+        size_t offset = (k->len + 1 + DATA_ALIGN - 1) & ~(DATA_ALIGN - 1);
+        char* key = _ALLOC((store == HASH_STORE_COPY) ? offset + size : k->len + 1);
+        memcpy(key, k->str, k->len);
+        key[k->len] = '\0';
+        entry->key = key;
+        buf = &key[offset];
+    }
+
+    if(store == HASH_STORE_COPY) {
+        entry->data = (size != 0) ? buf : NULL;
+        if(size != 0)
+            memcpy(entry->data, data, size);
+    }
+    else if(store == HASH_STORE_PTR)
+        entry->data = data;
+    else {
+        memset(entry->value, 0, HASH_INLINE_SIZE);
+        if(size != 0)
+            memcpy(entry->value, data, size);
+    }
+
+    entry->size = size;
+    entry->len = k->len;
+    entry->hash = k->hash;
+    set_ctrl(&tab->cur, slot, hash_h2(k->hash));
+
+    return entry;
+}
+
+// Find the key or add it. The buckets are made ready for an insert first,
+// so the probe of the current buckets finds the key or the bucket to put it
+// in, and the old buckets are only looked at if the key is not in the
+// current ones. If value is not NULL, it is set to the stored value of the
+// entry that was found or added.
+static inline HashResult upsert_entry(HashTable* tab, const _hash_key* k, bool num, void* data,
+                                      size_t size, void** value) {
+
+    if((tab->flags & HASH_STORE_MASK) == HASH_STORE_INLINE && size > HASH_INLINE_SIZE)
+        return HASH_SIZE;
+
+    rehash_table(tab);
+
+    int free;
+    _hash_entry* entry;
+    HashResult res = HASH_DUP;
+    int slot = probe_slot(tab, &tab->cur, k, num, &free);
+
+    if(slot >= 0)
+        entry = bucket_entry(tab, &tab->cur, slot);
+    else if(is_migrating(tab) && (slot = probe_slot(tab, &tab->old, k, num, NULL)) >= 0)
+        entry = &tab->old.entries[slot];
+    else {
+        entry = add_entry(tab, free, k, data, size);
+        res = HASH_OK;
     }
 
+    if(value != NULL)
+        *value = entry_value(tab, entry);
+
+    return res;
+}
+
+// Copy the value out. If the size that is given is not the size that was
+// stored, the smaller of the two is copied.
+static inline HashResult find_value(HashTable* tab, const _hash_key* k, bool num, void* data,
+                                    size_t size) {
+
+    _hash_buckets* b;
+    int slot = find_entry(tab, k, num, &b);
+    if(slot < 0)
+        return HASH_NF;
+
+    _hash_entry* entry = bucket_entry(tab, b, slot);
+    if(size > entry->size)
+        size = entry->size;
+    if(size != 0)
+        memcpy(data, entry_value(tab, entry), size);
+
     return HASH_OK;
 }
 
-HashResult find_hashtable(HashTable* tab, const char* key, void* data, size_t size) {
+// Return a pointer to the stored value, or NULL if the key is not found.
+static inline void* lookup_value(HashTable* tab, const _hash_key* k, bool num) {
 
-    int slot = find_slot(tab, key);
+    _hash_buckets* b;
+    int slot = find_entry(tab, k, num, &b);
 
-    if(tab->table[slot] != NULL && tab->table[slot]->key != NULL) {
-        if(strcmp(tab->table[slot]->key, key) == 0) {
-            if(tab->table[slot]->size != size)
-                printf("data size mismatch: %lu != %lu\n", size,
-                       tab->table[slot]->size);
-            memcpy(data, tab->table[slot]->data, size);
-            return HASH_OK;
-        }
+    return (slot < 0) ? NULL : entry_value(tab, bucket_entry(tab, b, slot));
+}
+
+static inline HashResult remove_entry(HashTable* tab, const _hash_key* k, bool num) {
+
+    _hash_buckets* b;
+    int slot = find_entry(tab, k, num, &b);
+    if(slot < 0)
+        return HASH_NF;
+
+    _hash_entry* entry = bucket_entry(tab, b, slot);
+    free_entry(tab, entry);
+    if(tab->flags & HASH_ORDERED)
+        entry->len = HOLE_LEN; // it stays in the list until the buckets are made again
+    set_ctrl(b, slot, CTRL_DELETED);
+    tab->count--;
+    if(b == &tab->old)
+        tab->old_count--;
+    else
+        tab->tombstones++;
+
+    if(is_migrating(tab))
+        migrate_table(tab, HASH_MIGRATE);
+
+    return HASH_OK;
+}
+
+// The string keys. A string key is any bytes with a length, which are
+// compared with memcmp(). The hash is hash_bytes() of the key, with the seed
+// for the run. A table with a seed of its own hashes the key again with that
+// seed, instead of mixing it into the hash for the run, so keys that collide
+// with one seed do not collide with the other.
+static inline uint32_t key_hash(HashTable* tab, const void* key, size_t len) {
+
+    if(tab->flags & HASH_SEED) {
+        uint64_t hash = hash_bytes64(key, len, tab->seed);
+        return (uint32_t)(hash ^ (hash >> 32));
     }
 
-    return HASH_NF;
+    return hash_bytes(key, len);
+}
+
+// The hash that a caller kept, or that a Str keeps, is only used if the
+// table does not have a seed of its own.
+static inline uint32_t given_hash(HashTable* tab, const void* key, size_t len, uint32_t hash) {
+
+    return (tab->flags & HASH_SEED) ? key_hash(tab, key, len) : hash;
+}
+
+static inline uint32_t str_hash(HashTable* tab, Str* key) {
+
+    return (tab->flags & HASH_SEED) ? key_hash(tab, raw_string(key), length_string(key))
+                                    : hash_string(key);
+}
+
+#define STR_KEY(key, len, hash) (&(_hash_key){ (key), (len), 0, (hash) })
+
+static HashResult upsert_key(HashTable* tab, const char* key, size_t len, uint32_t hash,
+                             void* data, size_t size, void** value) {
+
+    assert(!(tab->flags & HASH_KEY_INT));
+    return upsert_entry(tab, STR_KEY(key, len, hash), false, data, size, value);
+}
+
+static HashResult insert_key(HashTable* tab, const char* key, size_t len, uint32_t hash,
+                             void* data, size_t size) {
+
+    return upsert_key(tab, key, len, hash, data, size, NULL);
+}
+
+static HashResult find_key(HashTable* tab, const char* key, size_t len, uint32_t hash,
+                           void* data, size_t size) {
+
+    assert(!(tab->flags & HASH_KEY_INT));
+    return find_value(tab, STR_KEY(key, len, hash), false, data, size);
+}
+
+static void* lookup_key(HashTable* tab, const char* key, size_t len, uint32_t hash) {
+
+    assert(!(tab->flags & HASH_KEY_INT));
+    return lookup_value(tab, STR_KEY(key, len, hash), false);
+}
+
+static HashResult remove_key(HashTable* tab, const char* key, size_t len, uint32_t hash) {
+
+    assert(!(tab->flags & HASH_KEY_INT));
+    return remove_entry(tab, STR_KEY(key, len, hash), false);
+}
+
+// The integer keys, for tables that are made with HASH_KEY_INT. The key is
+// mixed with the seed of the table into the hash and compared as a number.
+#define NUM_KEY(key) (&(_hash_key){ NULL, 0, (key), hash_num((key) ^ tab->seed) })
+
+static HashResult upsert_num(HashTable* tab, uint64_t key, void* data, size_t size,
+                             void** value) {
+
+    assert(tab->flags & HASH_KEY_INT);
+    return upsert_entry(tab, NUM_KEY(key), true, data, size, value);
+}
+
+static HashResult find_num(HashTable* tab, uint64_t key, void* data, size_t size) {
+
+    assert(tab->flags & HASH_KEY_INT);
+    return find_value(tab, NUM_KEY(key), true, data, size);
+}
+
+static void* lookup_num(HashTable* tab, uint64_t key) {
+
+    assert(tab->flags & HASH_KEY_INT);
+    return lookup_value(tab, NUM_KEY(key), true);
+}
+
+static HashResult remove_num(HashTable* tab, uint64_t key) {
+
+    assert(tab->flags & HASH_KEY_INT);
+    return remove_entry(tab, NUM_KEY(key), true);
+}
+
+HashResult insert_hashtable(HashTable* table, const char* key, void* data, size_t size) {
+
+    size_t len = strlen(key);
+    return insert_key(table, key, len, key_hash(table, key, len), data, size);
+}
+
+HashResult find_hashtable(HashTable* tab, const char* key, void* data, size_t size) {
+
+    size_t len = strlen(key);
+    return find_key(tab, key, len, key_hash(tab, key, len), data, size);
 }
 
 HashResult remove_hashtable(HashTable* tab, const char* key) {
 
-    int slot = find_slot(tab, key);
-
-    if((tab->table[slot] != NULL) && (tab->table[slot]->key != NULL)) {
-        if(strcmp(tab->table[slot]->key, key) == 0) {
-            _FREE(tab->table[slot]->data);
-            _FREE(tab->table[slot]->key);
-            tab->table[slot]->key = NULL;
-            tab->table[slot]->data = NULL;
-            tab->table[slot]->size = 0;
-            tab->count--;
-            tab->tombstones++;
-            return HASH_OK;
+    size_t len = strlen(key);
+    return remove_key(tab, key, len, key_hash(tab, key, len));
+}
+
+// Return a pointer to the value that is stored for the key, or NULL if the
+// key is not in the table. For HASH_STORE_PTR this is the pointer that was
+// given to the insert. A copy of the data stays where it is until the key
+// is removed, but a value that is stored in the entry moves when the table
+// is changed, so that pointer is only good until the next insert or remove.
+void* lookup_hashtable(HashTable* tab, const char* key) {
+
+    size_t len = strlen(key);
+    return lookup_key(tab, key, len, key_hash(tab, key, len));
+}
+
+// Find the key, or add it with the data if it is not there, with one probe.
+// Returns HASH_OK if the key was added and HASH_DUP if it was already there,
+// in which case the data is not used. Either way, value is set to what
+// lookup_hashtable() would return for the key, unless it is NULL.
+HashResult upsert_hashtable(HashTable* table, const char* key, void* data, size_t size, void** value) {
+
+    size_t len = strlen(key);
+    return upsert_key(table, key, len, key_hash(table, key, len), data, size, value);
+}
+
+// The key is the characters of the view. The table keeps its own copy.
+HashResult insert_hashtable_view(HashTable* table, StrView key, void* data, size_t size) {
+
+    return insert_key(table, key.ptr, key.len, key_hash(table, key.ptr, key.len), data, size);
+}
+
+HashResult find_hashtable_view(HashTable* tab, StrView key, void* data, size_t size) {
+
+    return find_key(tab, key.ptr, key.len, key_hash(tab, key.ptr, key.len), data, size);
+}
+
+HashResult remove_hashtable_view(HashTable* tab, StrView key) {
+
+    return remove_key(tab, key.ptr, key.len, key_hash(tab, key.ptr, key.len));
+}
+
+void* lookup_hashtable_view(HashTable* tab, StrView key) {
+
+    return lookup_key(tab, key.ptr, key.len, key_hash(tab, key.ptr, key.len));
+}
+
+HashResult upsert_hashtable_view(HashTable* table, StrView key, void* data, size_t size, void** value) {
+
+    return upsert_key(table, key.ptr, key.len, key_hash(table, key.ptr, key.len), data, size,
+                      value);
+}
+
+// A Str key uses the length and the hash that the Str keeps, so looking up
+// the same Str again does not hash it again.
+HashResult insert_hashtable_Str(HashTable* table, Str* key, void* data, size_t size) {
+
+    return insert_key(table, raw_string(key), length_string(key), str_hash(table, key), data, size);
+}
+
+HashResult find_hashtable_Str(HashTable* tab, Str* key, void* data, size_t size) {
+
+    return find_key(tab, raw_string(key), length_string(key), str_hash(tab, key), data, size);
+}
+
+HashResult remove_hashtable_Str(HashTable* tab, Str* key) {
+
+    return remove_key(tab, raw_string(key), length_string(key), str_hash(tab, key));
+}
+
+void* lookup_hashtable_Str(HashTable* tab, Str* key) {
+
+    return lookup_key(tab, raw_string(key), length_string(key), str_hash(tab, key));
+}
+
+HashResult upsert_hashtable_Str(HashTable* table, Str* key, void* data, size_t size, void** value) {
+
+    return upsert_key(table, raw_string(key), length_string(key), str_hash(table, key), data, size,
+                      value);
+}
+
+// The caller gives the hash, which must be hash_bytes() of the key. It
+// saves hashing the key again, except in a table made with HASH_SEED. Using
+// the hash for the run would bypass the seed of the table, so such a table
+// hashes the key with its own seed and the hash that is given is not used.
+HashResult insert_hashtable_hashed(HashTable* table, const char* key, size_t len, uint32_t hash,
+                                   void* data, size_t size) {
+
+    return insert_key(table, key, len, given_hash(table, key, len, hash), data, size);
+}
+
+HashResult find_hashtable_hashed(HashTable* tab, const char* key, size_t len, uint32_t hash,
+                                 void* data, size_t size) {
+
+    return find_key(tab, key, len, given_hash(tab, key, len, hash), data, size);
+}
+
+HashResult remove_hashtable_hashed(HashTable* tab, const char* key, size_t len, uint32_t hash) {
+
+    return remove_key(tab, key, len, given_hash(tab, key, len, hash));
+}
+
+void* lookup_hashtable_hashed(HashTable* tab, const char* key, size_t len, uint32_t hash) {
+
+    return lookup_key(tab, key, len, given_hash(tab, key, len, hash));
+}
+
+HashResult upsert_hashtable_hashed(HashTable* table, const char* key, size_t len, uint32_t hash,
+                                   void* data, size_t size, void** value) {
+
+    return upsert_key(table, key, len, given_hash(table, key, len, hash), data, size, value);
+}
+
+// Any bytes with a length can be a key, including bytes that are zero.
+HashResult insert_hashtable_bytes(HashTable* table, const void* key, size_t len, void* data,
+                                  size_t size) {
+
+    return insert_key(table, key, len, key_hash(table, key, len), data, size);
+}
+
+HashResult find_hashtable_bytes(HashTable* tab, const void* key, size_t len, void* data,
+                                size_t size) {
+
+    return find_key(tab, key, len, key_hash(tab, key, len), data, size);
+}
+
+HashResult remove_hashtable_bytes(HashTable* tab, const void* key, size_t len) {
+
+    return remove_key(tab, key, len, key_hash(tab, key, len));
+}
+
+void* lookup_hashtable_bytes(HashTable* tab, const void* key, size_t len) {
+
+    return lookup_key(tab, key, len, key_hash(tab, key, len));
+}
+
+HashResult upsert_hashtable_bytes(HashTable* table, const void* key, size_t len, void* data,
+                                  size_t size, void** value) {
+
+    return upsert_key(table, key, len, key_hash(table, key, len), data, size, value);
+}
+
+// Integer keys are kept in the entry, so there is no allocation for the
+// key, no strlen() and no memcmp(). The table must be made with
+// HASH_KEY_INT.
+HashResult insert_hashtable_u64(HashTable* table, uint64_t key, void* data, size_t size) {
+
+    return upsert_num(table, key, data, size, NULL);
+}
+
+HashResult find_hashtable_u64(HashTable* tab, uint64_t key, void* data, size_t size) {
+
+    return find_num(tab, key, data, size);
+}
+
+HashResult remove_hashtable_u64(HashTable* tab, uint64_t key) {
+
+    return remove_num(tab, key);
+}
+
+void* lookup_hashtable_u64(HashTable* tab, uint64_t key) {
+
+    return lookup_num(tab, key);
+}
+
+HashResult upsert_hashtable_u64(HashTable* table, uint64_t key, void* data, size_t size,
+                                void** value) {
+
+    return upsert_num(table, key, data, size, value);
+}
+
+// A pointer is an integer key, so the table must be made with HASH_KEY_INT.
+// The key is the address, not what it points to.
+HashResult insert_hashtable_ptr(HashTable* table, const void* key, void* data, size_t size) {
+
+    return upsert_num(table, (uintptr_t)key, data, size, NULL);
+}
+
+HashResult find_hashtable_ptr(HashTable* tab, const void* key, void* data, size_t size) {
+
+    return find_num(tab, (uintptr_t)key, data, size);
+}
+
+HashResult remove_hashtable_ptr(HashTable* tab, const void* key) {
+
+    return remove_num(tab, (uintptr_t)key);
+}
+
+void* lookup_hashtable_ptr(HashTable* tab, const void* key) {
+
+    return lookup_num(tab, (uintptr_t)key);
+}
+
+HashResult upsert_hashtable_ptr(HashTable* table, const void* key, void* data, size_t size,
+                                void** value) {
+
+    return upsert_num(table, (uintptr_t)key, data, size, value);
+}
+
+// Iterate the entries. A HASH_ORDERED table gives them in the order that
+// they were added, and other tables give them in bucket order. Adding or
+// removing keys while iterating is not allowed.
+HashIter* init_hashtable_iterator(HashTable* tab) {
+
+    HashIter* iter = _ALLOC_T(HashIter);
+    iter->table = tab;
+    iter->index = 0;
+    iter->old = false;
+    iter->key = NULL;
+    iter->len = 0;
+    iter->num = 0;
+    iter->value = NULL;
+
+    return iter;
+}
+
+static _hash_entry* next_entry(HashIter* iter) {
+
+    HashTable* tab = iter->table;
+
+    if(tab->flags & HASH_ORDERED) {
+        // one pass over the list, skipping the holes
+        _hash_entry* list = raw_list(tab->order);
+        int len = length_list(tab->order);
+        while(iter->index < len) {
+            _hash_entry* entry = &list[iter->index++];
+            if(entry->len != HOLE_LEN)
+                return entry;
+        }
+        return NULL;
+    }
+
+    while(true) {
+        _hash_buckets* b = iter->old ? &tab->old : &tab->cur;
+        while(iter->index < b->cap) {
+            int slot = iter->index++;
+            if(is_full(b->ctrl[slot]))
+                return &b->entries[slot];
         }
+
+        // the entries that have not been moved yet are in the old buckets
+        if(iter->old || !is_migrating(tab))
+            return NULL;
+        iter->old = true;
+        iter->index = 0;
+    }
+}
+
+// Move to the next entry and set the key and the value in the iterator.
+// Returns false when there are no more entries. The key is NULL for
+// HASH_KEY_INT tables, which set num instead.
+bool iterate_hashtable(HashIter* iter) {
+
+    _hash_entry* entry = next_entry(iter);
+    if(entry == NULL)
+        return false;
+
+    if(iter->table->flags & HASH_KEY_INT) {
+        iter->key = NULL;
+        iter->num = entry->num;
     }
+    else {
+        iter->key = entry->key;
+        iter->num = 0;
+    }
+    iter->len = entry->len;
+    iter->value = entry_value(iter->table, entry);
+
+    return true;
+}
+
+// Count the groups that a lookup of every entry looks at, with the same
+// probe and the same key compare that the lookups use. An entry that has
+// not been moved yet is looked up in the old buckets.
+void probe_stats_hashtable(HashTable* tab, HashProbeStats* stats) {
+
+    bool num = (tab->flags & HASH_KEY_INT) != 0;
+    _hash_buckets* sets[] = { &tab->cur, &tab->old };
 
-    return HASH_NF;
+    memset(stats, 0, sizeof(HashProbeStats));
+    stats->cap = tab->cur.cap;
+
+    for(int s = 0; s < 2; s++) {
+        _hash_buckets* b = sets[s];
+        if(b->ctrl == NULL)
+            continue;
+
+        for(int i = 0; i < b->cap; i++) {
+            if(!is_full(b->ctrl[i]))
+                continue;
+
+            _hash_entry* entry = bucket_entry(tab, b, i);
+            _hash_key k = { num ? NULL : entry->key, entry->len, num ? entry->num : 0,
+                            entry->hash };
+            int groups = 0;
+            probe_groups(tab, b, &k, num, NULL, &groups);
+
+            stats->keys++;
+            stats->groups += groups;
+            stats->most = (groups > stats->most) ? groups : stats->most;
+            stats->hist[(groups < HASH_PROBE_HIST) ? groups - 1 : HASH_PROBE_HIST - 1]++;
+        }
+    }
 }
@@ -0,0 +1,106 @@
+
+#include <time.h>
+
+#include "util.h"
+
+// The hash that the table used before, to compare against.
+static uint32_t fnv1a(const void* key, size_t len) {
+
+    const uint8_t* ptr = (const uint8_t*)key;
+    uint32_t hash = 2166136261u;
+
+    for(size_t i = 0; i < len; i++) {
+        hash ^= ptr[i];
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
+typedef uint32_t (*HashFunc)(const void* key, size_t len);
+
+static double now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Make count keys from the format, with the number in them.
+static StrList* make_keys(const char* fmt, int count) {
+
+    StrList* lst = create_string_list();
+    for(int i = 0; i < count; i++)
+        add_string_list(lst, create_string_fmt(fmt, i, i * 7 % 13));
+
+    return lst;
+}
+
+static void time_hash(const char* name, HashFunc func, StrList* keys) {
+
+    int count = keys->len / keys->size;
+    Str** list = (Str**)keys->buffer;
+    size_t bytes = 0;
+    uint32_t sum = 0;
+    int rounds = 0;
+
+    double start = now();
+    double end;
+    do {
+        for(int i = 0; i < count; i++) {
+            sum += func(raw_string(list[i]), length_string(list[i]));
+            bytes += length_string(list[i]);
+        }
+        rounds++;
+    } while((end = now()) - start < 0.2);
+
+    printf("  %-8s %8.1f MB/s %6.1f ns/key (%08x)\n", name, bytes / (end - start) / 1e6,
+           (end - start) * 1e9 / ((double)rounds * count), sum);
+}
+
+// Count the groups that a lookup of every key looks at, with the hash that
+// is given in place of the one that the table uses.
+static void probe_lengths(const char* name, HashFunc func, StrList* keys) {
+
+    HashTable* tab = create_hashtable();
+    int count = keys->len / keys->size;
+    Str** list = (Str**)keys->buffer;
+    HashProbeStats st;
+
+    for(int i = 0; i < count; i++) {
+        const char* key = raw_string(list[i]);
+        int len = length_string(list[i]);
+        insert_hashtable_hashed(tab, key, len, func(key, len), NULL, 0);
+    }
+
+    probe_stats_hashtable(tab, &st);
+    printf("  %-8s groups: avg %.3f max %d  1:%d 2:%d 3:%d 4:%d 5+:%d (%d keys, cap %d)\n", name,
+           (double)st.groups / st.keys, st.most, st.hist[0], st.hist[1], st.hist[2], st.hist[3],
+           st.hist[4], st.keys, st.cap);
+
+    destroy_hashtable(tab);
+}
+
+static void run(const char* title, StrList* keys) {
+
+    printf("%s\n", title);
+    time_hash("fnv1a", fnv1a, keys);
+    time_hash("wyhash", hash_bytes, keys);
+    probe_lengths("fnv1a", fnv1a, keys);
+    probe_lengths("wyhash", hash_bytes, keys);
+    printf("\n");
+}
+
+int main() {
+
+    run("identifiers", make_keys("symbol_%d_v%d", 50000));
+    run("numbers", make_keys("%d", 50000));
+    run("file names", make_keys("/home/user/src/project/module_%d/source_file_%d.c", 50000));
+    run("options", make_keys("--option-name-%d=%d", 50000));
+    run("long lines",
+        make_keys("%d: a line of source text that is long enough to be hashed a word at a time, "
+                  "%d times over",
+                  50000));
+
+    return 0;
+}
@@ -4,20 +4,10 @@
 
 void dump(HashTable* tab) {
 
-    printf("\ntab->cap = %d\n", tab->cap);
-    printf("tab->count = %d\n", tab->count);
-    printf("tab->tombstones = %d\n", tab->tombstones);
-    for(int i = 0; i < tab->cap; i++) {
-        if(tab->table[i] != NULL) {
-            if(tab->table[i]->key != NULL)
-                printf("%3d.\t%s\t%lu\n", i + 1, tab->table[i]->key,
-                       *(long*)tab->table[i]->data); //, tab->table[i]->hash);
-            else
-                printf("%3d.\ttombstone\n", i + 1);
-        }
-        else
-            printf("%3d.\tblank\n", i + 1);
-    }
+    printf("\ncount = %d\n", tab->count);
+    HashIter* iter = init_hashtable_iterator(tab);
+    while(iterate_hashtable(iter))
+        printf("\t%s\t%lu\n", iter->key, *(long*)iter->value);
 
     printf("\n");
 }
@@ -29,6 +19,9 @@ int main() {
                            "fghj", "vbnm", "tyui", "ghjk", "bnm",
                            "yuio", "hjkl", "uiop", "jkl",  NULL };
 
+    // the same hashes every time, so the dumps can be compared
+    set_hash_seed(1);
+
     HashTable* table = create_hashtable();
     long value;
 
@@ -88,5 +81,292 @@ int main() {
     printf("find: %s: %s: %lu\n\n", str, res ? "true" : "false", val);
     val = 0;
 
+    char buf[32];
+
+    // Str keys keep their hash, so looking them up again does not rehash
+    Str* skey = create_string("erty");
+    res = find_hashtable_Str(table, skey, &val, sizeof(val));
+    printf("find Str: %s: %s: %lu\n", raw_string(skey), (res == HASH_OK) ? "true" : "false", val);
+    val = 0;
+    add_string_str(skey, "x");
+    res = find_hashtable_Str(table, skey, &val, sizeof(val));
+    printf("find Str: %s: %s: %lu\n", raw_string(skey), (res == HASH_OK) ? "true" : "false", val);
+    value = 1234;
+    insert_hashtable_Str(table, skey, &value, sizeof(value));
+    res = find_hashtable(table, "ertyx", &val, sizeof(val));
+    printf("find: ertyx: %s: %lu\n", (res == HASH_OK) ? "true" : "false", val);
+    res = find_hashtable_hashed(table, "ertyx", 5, hash_string(skey), &val, sizeof(val));
+    printf("find hashed: ertyx: %s: %lu\n", (res == HASH_OK) ? "true" : "false", val);
+    res = remove_hashtable_Str(table, skey);
+    printf("remove Str: %s\n\n", (res == HASH_OK) ? "true" : "false");
+    destroy_string(skey);
+
+    // a lot of keys, so that the probes cross groups
+    HashTable* big = create_hashtable();
+    for(long i = 0; i < 20000; i++) {
+        snprintf(buf, sizeof(buf), "key%ld", i);
+        insert_hashtable(big, buf, &i, sizeof(i));
+    }
+    for(long i = 0; i < 20000; i += 2) {
+        snprintf(buf, sizeof(buf), "key%ld", i);
+        remove_hashtable(big, buf);
+    }
+    int found = 0, right = 0;
+    for(long i = 0; i < 20000; i++) {
+        snprintf(buf, sizeof(buf), "key%ld", i);
+        if(find_hashtable(big, buf, &val, sizeof(val)) == HASH_OK) {
+            found++;
+            right += (val == i);
+        }
+    }
+    printf("big: count %d found %d right %d cap %d\n\n", big->count, found, right, big->cur.cap);
+    destroy_hashtable(big);
+
+    // keys that are added and removed all of the time do not grow the table
+    HashTable* churn = create_hashtable();
+    int maxcap = 0;
+    for(long i = 0; i < 100000; i++) {
+        snprintf(buf, sizeof(buf), "churn%ld", i);
+        insert_hashtable(churn, buf, &i, sizeof(i));
+        if(i >= 100) {
+            snprintf(buf, sizeof(buf), "churn%ld", i - 100);
+            remove_hashtable(churn, buf);
+        }
+        if(churn->cur.cap > maxcap)
+            maxcap = churn->cur.cap;
+    }
+    snprintf(buf, sizeof(buf), "churn%d", 99950);
+    res = find_hashtable(churn, buf, &val, sizeof(val));
+    printf("churn: count %d max cap %d find %s: %s %ld\n\n", churn->count, maxcap, buf,
+           (res == HASH_OK) ? "true" : "false", val);
+    destroy_hashtable(churn);
+
+    // a key that was moved to the new buckets and then removed is not found
+    // in the old ones
+    HashTable* moved = create_hashtable();
+    long added = 0;
+    while(moved->old.ctrl == NULL || moved->old.cap < 1024) {
+        snprintf(buf, sizeof(buf), "moved%ld", added);
+        insert_hashtable(moved, buf, &added, sizeof(added));
+        added++;
+    }
+    found = 0;
+    for(long i = 0; i < added; i++) {
+        snprintf(buf, sizeof(buf), "moved%ld", i);
+        remove_hashtable(moved, buf);
+        if(find_hashtable(moved, buf, &val, sizeof(val)) == HASH_OK)
+            found++;
+    }
+    printf("moved: added %ld removed all, count %d found %d\n\n", added, moved->count, found);
+    destroy_hashtable(moved);
+    // the data pointer is kept, not a copy of the data
+    HashTable* ptrs = create_hashtable_flags(HASH_STORE_PTR);
+    long nums[] = { 10, 20, 30 };
+    insert_hashtable(ptrs, "ten", &nums[0], sizeof(long));
+    insert_hashtable(ptrs, "twenty", &nums[1], sizeof(long));
+    insert_hashtable(ptrs, "thirty", &nums[2], sizeof(long));
+    nums[1] = 21;
+    long* lp = lookup_hashtable(ptrs, "twenty");
+    res = find_hashtable(ptrs, "thirty", &val, sizeof(val));
+    printf("ptr: same pointer %s, value %ld, find %s %ld, missing %s\n",
+           (lp == &nums[1]) ? "true" : "false", *lp, (res == HASH_OK) ? "true" : "false", val,
+           (lookup_hashtable(ptrs, "forty") == NULL) ? "NULL" : "found");
+    destroy_hashtable(ptrs);
+
+    // small values are stored in the entry, and upsert counts with one probe
+    HashTable* counts = create_hashtable_flags(HASH_STORE_INLINE);
+    const char* words = "the cat and the dog and the bird";
+    long zero = 0;
+    for(const char* w = words; *w != '\0';) {
+        int n = strcspn(w, " ");
+        void* ptr;
+        upsert_hashtable_view(counts, view_bytes(w, n), &zero, sizeof(zero), &ptr);
+        (*(long*)ptr)++;
+        w += n + (w[n] == ' ');
+    }
+    printf("inline: the %ld, and %ld, bird %ld, count %d\n", *(long*)lookup_hashtable(counts, "the"),
+           *(long*)lookup_hashtable(counts, "and"), *(long*)lookup_hashtable(counts, "bird"),
+           counts->count);
+    printf("upsert existing: %s\n",
+           (upsert_hashtable(counts, "cat", &zero, sizeof(zero), NULL) == HASH_DUP) ? "dup" : "added");
+    HashResult hr = insert_hashtable(counts, "big", buf, sizeof(buf));
+    printf("too big to store inline: %s\n", (hr == HASH_SIZE) ? "size" : "stored");
+    int small = 0;
+    res = find_hashtable(counts, "the", &small, sizeof(small));
+    printf("find smaller: %d\n\n", small);
+    destroy_hashtable(counts);
+
+    // integer keys are stored in the entry
+    HashTable* ints = create_hashtable_flags(HASH_KEY_INT | HASH_STORE_INLINE);
+    for(uint64_t i = 0; i < 20000; i++) {
+        uint64_t sq = i * i;
+        insert_hashtable_u64(ints, i << 32, &sq, sizeof(sq));
+    }
+    for(uint64_t i = 0; i < 20000; i += 3)
+        remove_hashtable_u64(ints, i << 32);
+    found = right = 0;
+    for(uint64_t i = 0; i < 20000; i++) {
+        uint64_t* sq = lookup_hashtable_u64(ints, i << 32);
+        if(sq != NULL) {
+            found++;
+            right += (*sq == i * i);
+        }
+    }
+    printf("u64: count %d found %d right %d, dup %s\n", ints->count, found, right,
+           (insert_hashtable_u64(ints, 1ull << 32, &val, sizeof(val)) == HASH_DUP) ? "true" : "false");
+    destroy_hashtable(ints);
+
+    // pointer keys are the address, not what they point to
+    HashTable* addrs = create_hashtable_flags(HASH_KEY_INT);
+    for(int i = 0; i < 3; i++)
+        insert_hashtable_ptr(addrs, &nums[i], &i, sizeof(i));
+    int idx = -1;
+    res = find_hashtable_ptr(addrs, &nums[2], &idx, sizeof(idx));
+    printf("ptr keys: find %s %d, other address %s\n", (res == HASH_OK) ? "true" : "false", idx,
+           (lookup_hashtable_ptr(addrs, &val) == NULL) ? "NULL" : "found");
+    res = remove_hashtable_ptr(addrs, &nums[0]);
+    printf("ptr keys: remove %s, count %d\n", (res == HASH_OK) ? "true" : "false", addrs->count);
+    destroy_hashtable(addrs);
+
+    // binary keys can have zeros in them
+    HashTable* bins = create_hashtable();
+    const char bin1[] = { 'a', 0, 'b' };
+    const char bin2[] = { 'a', 0, 'c' };
+    value = 1;
+    insert_hashtable_bytes(bins, bin1, sizeof(bin1), &value, sizeof(value));
+    value = 2;
+    insert_hashtable_bytes(bins, bin2, sizeof(bin2), &value, sizeof(value));
+    value = 3;
+    insert_hashtable_bytes(bins, bin1, 1, &value, sizeof(value));
+    printf("bytes: count %d, a\\0b %ld, a\\0c %ld, a %ld\n\n", bins->count,
+           *(long*)lookup_hashtable_bytes(bins, bin1, sizeof(bin1)),
+           *(long*)lookup_hashtable_bytes(bins, bin2, sizeof(bin2)), *(long*)lookup_hashtable(bins, "a"));
+    destroy_hashtable(bins);
+
+    // a borrowed key is the pointer that was given, and the data is still copied
+    HashTable* borrow = create_hashtable_flags(HASH_KEY_BORROW);
+    const char* names[] = { "alpha", "beta", "gamma" };
+    for(long i = 0; i < 3; i++)
+        insert_hashtable(borrow, names[i], &i, sizeof(i));
+    remove_hashtable(borrow, "beta");
+    found = 0;
+    HashIter* bi = init_hashtable_iterator(borrow);
+    while(iterate_hashtable(bi))
+        found += (bi->key == names[0] || bi->key == names[2]);
+    printf("borrow: count %d same pointers %d, gamma %ld\n\n", borrow->count, found,
+           *(long*)lookup_hashtable(borrow, "gamma"));
+    destroy_hashtable(borrow);
+
+    // the hash reads a word at a time, so check keys of every length
+    char text[80];
+    for(int i = 0; i < (int)sizeof(text); i++)
+        text[i] = 'a' + i % 26;
+    HashTable* lens = create_hashtable_flags(HASH_SEED);
+    for(long i = 0; i <= (long)sizeof(text); i++)
+        insert_hashtable_bytes(lens, text, i, &i, sizeof(i));
+    found = right = 0;
+    for(long i = 0; i <= (long)sizeof(text); i++) {
+        long* lp = lookup_hashtable_bytes(lens, text, i);
+        found += (lp != NULL);
+        right += (lp != NULL && *lp == i);
+    }
+    printf("lengths: count %d found %d right %d\n", lens->count, found, right);
+    printf("seeded: same %s, other seed %s\n\n",
+           (hash_bytes64("abc", 3, 7) == hash_bytes64("abc", 3, 7)) ? "true" : "false",
+           (hash_bytes64("abc", 3, 7) != hash_bytes64("abc", 3, 8)) ? "differs" : "same");
+    destroy_hashtable(lens);
+
+    // two keys with the same hash for the run do not collide in a seeded table
+    HashTable* hashes = create_hashtable_flags(HASH_KEY_INT | HASH_STORE_INLINE);
+    char other[32];
+    long* prev = NULL;
+    for(long i = 0; prev == NULL; i++) {
+        snprintf(buf, sizeof(buf), "c%ld", i);
+        if(upsert_hashtable_u64(hashes, hash_bytes(buf, strlen(buf)), &i, sizeof(i),
+                                (void**)&prev) == HASH_OK)
+            prev = NULL;
+    }
+    snprintf(other, sizeof(other), "c%ld", *prev);
+    destroy_hashtable(hashes);
+
+    HashTable* seeded = create_hashtable_flags(HASH_SEED);
+    insert_hashtable(seeded, buf, NULL, 0);
+    insert_hashtable(seeded, other, NULL, 0);
+    uint32_t seeded_hash[2] = { 0, 0 };
+    for(int i = 0, n = 0; i < seeded->cur.cap; i++)
+        if(seeded->cur.entries[i].key != NULL)
+            seeded_hash[n++] = seeded->cur.entries[i].hash;
+    printf("seed: run hash same %s, table hash same %s\n\n",
+           (hash_bytes(buf, strlen(buf)) == hash_bytes(other, strlen(other))) ? "true" : "false",
+           (seeded_hash[0] == seeded_hash[1]) ? "true" : "false");
+    destroy_hashtable(seeded);
+
+    // iterating while the table is being resized sees every entry once
+    HashTable* grow = create_hashtable();
+    long sum = 0;
+    for(long i = 0; i < 1000; i++) {
+        snprintf(buf, sizeof(buf), "grow%ld", i);
+        insert_hashtable(grow, buf, &i, sizeof(i));
+    }
+    found = 0;
+    HashIter* gi = init_hashtable_iterator(grow);
+    while(iterate_hashtable(gi)) {
+        found++;
+        sum += *(long*)gi->value;
+    }
+    printf("iterate: count %d found %d sum %ld\n", grow->count, found, sum);
+    HashProbeStats st;
+    probe_stats_hashtable(grow, &st);
+    printf("probe: keys %d, all in 1 to 5+ groups %s, most %d\n", st.keys,
+           (st.hist[0] + st.hist[1] + st.hist[2] + st.hist[3] + st.hist[4] == st.keys &&
+            st.groups >= st.keys) ? "true" : "false",
+           st.most);
+    destroy_hashtable(grow);
+
+    // an ordered table iterates in the order the keys were added
+    HashTable* ordered = create_hashtable_flags(HASH_ORDERED | HASH_STORE_INLINE);
+    for(long i = 0; keys[i] != NULL; i++)
+        insert_hashtable(ordered, keys[i], &i, sizeof(i));
+    remove_hashtable(ordered, "asdf");
+    remove_hashtable(ordered, "tyui");
+    value = 99;
+    insert_hashtable(ordered, "asdf", &value, sizeof(value));
+    printf("ordered:");
+    HashIter* oi = init_hashtable_iterator(ordered);
+    while(iterate_hashtable(oi))
+        printf(" %s=%ld", oi->key, *(long*)oi->value);
+    printf("\n");
+
+    // keys that come and go leave holes in the list, which are taken out
+    for(long i = 0; i < 10000; i++) {
+        snprintf(buf, sizeof(buf), "o%ld", i);
+        insert_hashtable(ordered, buf, &i, sizeof(i));
+        if(i % 4 != 0)
+            remove_hashtable(ordered, buf);
+    }
+    found = right = 0;
+    long last = -1;
+    oi = init_hashtable_iterator(ordered);
+    while(iterate_hashtable(oi)) {
+        if(oi->key[0] == 'o') {
+            long n = *(long*)oi->value;
+            found++;
+            right += (n > last && n % 4 == 0 && *(long*)lookup_hashtable(ordered, oi->key) == n);
+            last = n;
+        }
+    }
+    printf("ordered churn: count %d found %d in order %d\n\n", ordered->count, found, right);
+    destroy_hashtable(ordered);
+
+    // lookups never change the table
+    int count = table->count, cap = table->cur.cap, tombstones = table->tombstones;
+    for(int i = 0; i < 1000; i++) {
+        snprintf(buf, sizeof(buf), "missing%d", i);
+        find_hashtable(table, buf, &val, sizeof(val));
+    }
+    printf("after misses: count %s, cap %s, tombstones %s\n\n",
+           (count == table->count) ? "same" : "changed", (cap == table->cur.cap) ? "same" : "changed",
+           (tombstones == table->tombstones) ? "same" : "changed");
+
     return 0;
 }
@@ -0,0 +1,121 @@
+/*
+ * String interning. Every distinct string is stored once as an Atom and
+ * interning the same characters again returns the same Atom. Two atoms
+ * from the same table are equal if, and only if, the pointers are equal,
+ * so comparing identifiers and keywords does not need strcmp().
+ *
+ * The atoms are stored in an arena of large chunks that are never moved
+ * or freed until the table is destroyed. The hash table maps the
+ * characters to the address of the atom. It keeps both as pointers into
+ * the arena without copying them, so the characters are only stored once.
+ */
+#include "util.h"
+
+#define INTERN_CHUNK 4096
+
+// Allocate size bytes from the arena. The result is aligned for an Atom.
+static void* arena_alloc(InternTable* tab, size_t size) {
+
+    size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+    if(tab->used + size > tab->avail) {
+        size_t len = (size > INTERN_CHUNK) ? size : INTERN_CHUNK;
+        tab->chunk = _ALLOC(len);
+        tab->used = 0;
+        tab->avail = len;
+        add_ptr_list(tab->chunks, tab->chunk);
+    }
+
+    void* ptr = &tab->chunk[tab->used];
+    tab->used += size;
+
+    return ptr;
+}
+
+InternTable* create_intern_table() {
+
+    InternTable* tab = _ALLOC_T(InternTable);
+    tab->table = create_hashtable_flags(HASH_STORE_PTR | HASH_KEY_BORROW);
+    tab->chunks = create_ptr_list();
+    tab->chunk = NULL;
+    tab->used = 0;
+    tab->avail = 0;
+    tab->count = 0;
+
+    return tab;
+}
+
+void destroy_intern_table(InternTable* tab) {
+
+    if(tab != NULL) {
+        void* chunk;
+        PtrListIter* iter = init_ptr_list_iterator(tab->chunks);
+        while(NULL != (chunk = iterate_ptr_list(iter)))
+            _FREE(chunk);
+        _FREE(iter);
+
+        destroy_ptr_list(tab->chunks);
+        destroy_hashtable(tab->table);
+        _FREE(tab);
+    }
+}
+
+static const Atom* find_atom(InternTable* tab, const char* str, int len, uint32_t hash) {
+
+    return lookup_hashtable_hashed(tab->table, str, len, hash);
+}
+
+// The key is hashed once and looked up or added with one probe. The atom
+// is made in the arena first so that the table can keep a pointer to its
+// characters as the key. If the key was already there, the atom is given
+// back to the arena.
+static const Atom* intern_bytes(InternTable* tab, const char* str, int len, uint32_t hash) {
+
+    unsigned char* chunk = tab->chunk;
+    size_t used = tab->used;
+    Atom* atom = arena_alloc(tab, sizeof(Atom) + len + 1);
+    char* chars = (char*)(atom + 1);
+
+    memcpy(chars, str, len);
+    chars[len] = '\0';
+
+    void* found;
+    if(upsert_hashtable_hashed(tab->table, chars, len, hash, atom, sizeof(Atom), &found) ==
+       HASH_DUP) {
+        // nothing else was taken from the arena since, so it can be undone
+        tab->used = (tab->chunk == chunk) ? used : 0;
+        return found;
+    }
+
+    atom->str = chars;
+    atom->len = len;
+    atom->hash = hash;
+    tab->count++;
+
+    return atom;
+}
+
+// Return the atom for the string or NULL if it has not been interned.
+const Atom* find_intern_str(InternTable* tab, const char* str) {
+
+    int len = strlen(str);
+    return find_atom(tab, str, len, hash_bytes(str, len));
+}
+
+// Return the atom for the string, creating it if it does not exist.
+const Atom* intern_str(InternTable* tab, const char* str) {
+
+    int len = strlen(str);
+    return intern_bytes(tab, str, len, hash_bytes(str, len));
+}
+
+// Uses the hash that the Str keeps.
+const Atom* intern_Str(InternTable* tab, Str* str) {
+
+    return intern_bytes(tab, raw_string(str), length_string(str), hash_string(str));
+}
+
+int length_intern_table(InternTable* tab) {
+
+    return tab->count;
+}
@@ -0,0 +1,57 @@
+
+#include "util.h"
+
+int main() {
+
+    // the same hashes every time, so the output can be compared
+    set_hash_seed(1);
+
+    const char* keywords[] = { "if", "else", "while", "for", "return", "break",
+                               "continue", "struct", "typedef", NULL };
+    const Atom* atoms[16];
+
+    InternTable* tab = create_intern_table();
+
+    printf("intern the keywords\n");
+    for(int i = 0; keywords[i] != NULL; i++) {
+        atoms[i] = intern_str(tab, keywords[i]);
+        printf("%2d. %-10s len: %d hash: 0x%08X\n", i, atoms[i]->str, atoms[i]->len,
+               atoms[i]->hash);
+    }
+    printf("count: %d\n\n", length_intern_table(tab));
+
+    printf("intern them again\n");
+    int same = 0;
+    for(int i = 0; keywords[i] != NULL; i++) {
+        Str* s = create_string(keywords[i]);
+        if(intern_Str(tab, s) == atoms[i])
+            same++;
+        destroy_string(s);
+    }
+    printf("same: %d count: %d\n\n", same, length_intern_table(tab));
+
+    printf("look up without interning\n");
+    printf("while: %s\n", (find_intern_str(tab, "while") == atoms[2]) ? "found" : "not found");
+    printf("until: %s\n", (find_intern_str(tab, "until") != NULL) ? "found" : "not found");
+    printf("count: %d\n\n", length_intern_table(tab));
+
+    printf("intern a lot of identifiers\n");
+    char buf[32];
+    for(int i = 0; i < 5000; i++) {
+        snprintf(buf, sizeof(buf), "ident_%d", i % 1000);
+        intern_str(tab, buf);
+    }
+    printf("count: %d\n", length_intern_table(tab));
+    printf("return: %s\n", (intern_str(tab, "return") == atoms[4]) ? "same" : "different");
+
+    // the table keeps the characters of the atom as its key, not a copy
+    int borrowed = 0;
+    HashIter* iter = init_hashtable_iterator(tab->table);
+    while(iterate_hashtable(iter))
+        borrowed += (iter->key == ((const Atom*)iter->value)->str);
+    printf("keys that are the atom characters: %d\n", borrowed);
+
+    destroy_intern_table(tab);
+
+    return 0;
+}
@@ -0,0 +1,247 @@
+/*
+ * Compressed integer list. Values are appended to an open block of raw
+ * integers. When the block fills, it is sealed: the values are replaced
+ * by the first value of the block and the zigzag encoded deltas between
+ * neighbours, bit packed at the smallest width that holds the largest
+ * delta. Sorted or slowly changing sequences such as offsets, line
+ * numbers and ids end up using a few bits per value.
+ *
+ * Every sealed block has a header in a List, so a block can be found and
+ * decoded directly from an index. Decoding a block is done in separate
+ * passes for unpacking, zigzag decoding and the running sum. The first
+ * two passes have no dependencies between iterations, so the compiler is
+ * able to vectorize them.
+ */
+#include "util.h"
+
+typedef struct {
+    int64_t first; // first value in the block, stored verbatim
+    int offset;    // index of the first packed word in the data list
+    int width;     // number of bits used for each delta
+} _int_block;
+
+static inline uint64_t zigzag_encode(int64_t val) {
+
+    return ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+}
+
+static inline int64_t zigzag_decode(uint64_t val) {
+
+    return (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+}
+
+static inline int bit_width(uint64_t val) {
+
+    return (val == 0) ? 0 : 64 - __builtin_clzll(val);
+}
+
+static inline uint64_t width_mask(int width) {
+
+    return (width >= 64) ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+}
+
+// Convert the open block into a sealed block.
+static void seal_block(IntList* lst) {
+
+    uint64_t deltas[INT_LIST_BLOCK];
+    uint64_t max = 0;
+    int n = lst->tail_len;
+
+    deltas[0] = 0;
+    for(int i = 1; i < n; i++) {
+        deltas[i] = zigzag_encode((int64_t)((uint64_t)lst->tail[i] - (uint64_t)lst->tail[i - 1]));
+        max |= deltas[i];
+    }
+
+    _int_block blk;
+    blk.first = lst->tail[0];
+    blk.width = bit_width(max);
+    blk.offset = length_list(lst->data);
+
+    if(blk.width > 0) {
+        int nwords = ((n - 1) * blk.width + 63) / 64;
+        uint64_t words[INT_LIST_BLOCK];
+        memset(words, 0, nwords * sizeof(uint64_t));
+
+        for(int i = 1; i < n; i++) {
+            int bit = (i - 1) * blk.width;
+            int word = bit >> 6;
+            int shift = bit & 63;
+            words[word] |= deltas[i] << shift;
+            if(shift + blk.width > 64)
+                words[word + 1] |= deltas[i] >> (64 - shift);
+        }
+
+        for(int i = 0; i < nwords; i++)
+            append_list(lst->data, &words[i]);
+    }
+
+    append_list(lst->blocks, &blk);
+    lst->tail_len = 0;
+}
+
+// Decode n values from a sealed block into out.
+static void decode_block(IntList* lst, _int_block* blk, int n, int64_t* out) {
+
+    uint64_t* words = (uint64_t*)raw_list(lst->data) + blk->offset;
+    uint64_t mask = width_mask(blk->width);
+    uint64_t tmp[INT_LIST_BLOCK];
+    int width = blk->width;
+
+    tmp[0] = 0;
+    if(width > 0) {
+        // unpack
+        for(int i = 1; i < n; i++) {
+            int bit = (i - 1) * width;
+            int word = bit >> 6;
+            int shift = bit & 63;
+            uint64_t val = words[word] >> shift;
+            if(shift + width > 64)
+                val |= words[word + 1] << (64 - shift);
+            tmp[i] = val & mask;
+        }
+    }
+    else {
+        for(int i = 1; i < n; i++)
+            tmp[i] = 0;
+    }
+
+    // zigzag decode
+    for(int i = 1; i < n; i++)
+        out[i] = zigzag_decode(tmp[i]);
+
+    // running sum
+    out[0] = blk->first;
+    for(int i = 1; i < n; i++)
+        out[i] = (int64_t)((uint64_t)out[i - 1] + (uint64_t)out[i]);
+}
+
+IntList* create_int_list() {
+
+    IntList* ptr = _ALLOC_T(IntList);
+    ptr->blocks = create_list(sizeof(_int_block));
+    ptr->data = create_list(sizeof(uint64_t));
+    ptr->tail_len = 0;
+    ptr->count = 0;
+
+    return ptr;
+}
+
+void destroy_int_list(IntList* lst) {
+
+    if(lst != NULL) {
+        destroy_list(lst->blocks);
+        destroy_list(lst->data);
+        _FREE(lst);
+    }
+}
+
+void append_int_list(IntList* lst, int64_t value) {
+
+    lst->tail[lst->tail_len++] = value;
+    lst->count++;
+
+    if(lst->tail_len == INT_LIST_BLOCK)
+        seal_block(lst);
+}
+
+void clear_int_list(IntList* lst) {
+
+    clear_list(lst->blocks);
+    clear_list(lst->data);
+    lst->tail_len = 0;
+    lst->count = 0;
+}
+
+int length_int_list(IntList* lst) {
+
+    return lst->count;
+}
+
+// Number of blocks, including the open block if it has any values.
+int blocks_int_list(IntList* lst) {
+
+    return length_list(lst->blocks) + ((lst->tail_len > 0) ? 1 : 0);
+}
+
+// Decode an entire block into out, which must have room for
+// INT_LIST_BLOCK values. Returns the number of values decoded.
+int decode_int_list(IntList* lst, int block, int64_t* out) {
+
+    int sealed = length_list(lst->blocks);
+
+    if(block >= 0 && block < sealed) {
+        _int_block* blk = (_int_block*)raw_list(lst->blocks) + block;
+        decode_block(lst, blk, INT_LIST_BLOCK, out);
+        return INT_LIST_BLOCK;
+    }
+    else if(block == sealed && lst->tail_len > 0) {
+        memcpy(out, lst->tail, lst->tail_len * sizeof(int64_t));
+        return lst->tail_len;
+    }
+    else
+        RAISE(LIST_ERROR, "List Error: block out of range: %d", block);
+}
+
+// Random access to a single value. This decodes the values in the block
+// up to the index.
+int64_t read_int_list(IntList* lst, int index) {
+
+    if(index < 0)
+        index = lst->count + index;
+
+    if(index < 0 || index >= lst->count)
+        RAISE(LIST_ERROR, "List Error: index out of range: %d", index);
+
+    int block = index / INT_LIST_BLOCK;
+    int pos = index % INT_LIST_BLOCK;
+
+    if(block == length_list(lst->blocks))
+        return lst->tail[pos];
+
+    int64_t out[INT_LIST_BLOCK];
+    _int_block* blk = (_int_block*)raw_list(lst->blocks) + block;
+    decode_block(lst, blk, pos + 1, out);
+
+    return out[pos];
+}
+
+// Number of bytes that are allocated to store the values, counting the
+// room that the lists have not used yet.
+size_t bytes_int_list(IntList* lst) {
+
+    return sizeof(IntList) + 2 * sizeof(List) + (size_t)lst->blocks->cap + (size_t)lst->data->cap;
+}
+
+IntListIter* init_int_list_iterator(IntList* lst) {
+
+    IntListIter* iter = _ALLOC_T(IntListIter);
+    iter->list = lst;
+    iter->index = 0;
+    iter->block = -1;
+    iter->avail = 0;
+
+    return iter;
+}
+
+// Sequential decode. One block is decoded at a time into the iterator.
+int iterate_int_list(IntListIter* iter, int64_t* value) {
+
+    IntList* lst = iter->list;
+
+    if(iter->index >= lst->count)
+        return 0; // finished
+
+    int block = iter->index / INT_LIST_BLOCK;
+    int pos = iter->index % INT_LIST_BLOCK;
+
+    if(block != iter->block || pos >= iter->avail) {
+        iter->avail = decode_int_list(lst, block, iter->buf);
+        iter->block = block;
+    }
+
+    *value = iter->buf[pos];
+    iter->index++;
+
+    return 1;
+}
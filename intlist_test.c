@@ -0,0 +1,56 @@
+
+#include "util.h"
+
+int main() {
+
+    IntList* lst = create_int_list();
+    int64_t value;
+    int errors = 0;
+
+    printf("add 1000 increasing offsets\n");
+    for(int i = 0; i < 1000; i++)
+        append_int_list(lst, 1000000 + i * 37 + (i % 5));
+
+    printf("len: %d blocks: %d bytes: %lu (raw: %lu)\n", length_int_list(lst),
+           blocks_int_list(lst), bytes_int_list(lst), 1000 * sizeof(int64_t));
+    printf("allocated is less than a third of raw: %s\n",
+           (bytes_int_list(lst) * 3 < 1000 * sizeof(int64_t)) ? "yes" : "no");
+
+    printf("selected reads\n");
+    printf("list[0]: %ld\n", read_int_list(lst, 0));
+    printf("list[127]: %ld\n", read_int_list(lst, 127));
+    printf("list[128]: %ld\n", read_int_list(lst, 128));
+    printf("list[999]: %ld\n", read_int_list(lst, 999));
+    printf("list[-1]: %ld\n", read_int_list(lst, -1));
+
+    printf("check with the iterator\n");
+    int count = 0;
+    IntListIter* iter = init_int_list_iterator(lst);
+    while(iterate_int_list(iter, &value)) {
+        if(value != 1000000 + count * 37 + (count % 5))
+            errors++;
+        count++;
+    }
+    printf("count: %d errors: %d\n", count, errors);
+
+    printf("decode block 3\n");
+    int64_t buf[INT_LIST_BLOCK];
+    int n = decode_int_list(lst, 3, buf);
+    printf("n: %d first: %ld last: %ld\n", n, buf[0], buf[n - 1]);
+
+    printf("mixed signs and wide deltas\n");
+    clear_int_list(lst);
+    int64_t vals[] = { 0, -1, INT64_MAX, INT64_MIN, 42, -42, 7, 7, 7 };
+    int nvals = sizeof(vals) / sizeof(vals[0]);
+    errors = 0;
+    for(int i = 0; i < 300; i++)
+        append_int_list(lst, vals[i % nvals]);
+    for(int i = 0; i < 300; i++)
+        if(read_int_list(lst, i) != vals[i % nvals])
+            errors++;
+    printf("len: %d errors: %d\n", length_int_list(lst), errors);
+
+    destroy_int_list(lst);
+
+    return 0;
+}
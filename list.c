@@ -25,12 +25,12 @@ static inline int normalize_index(List* lst, int idx) {
 
 // There is no need to catch memory errors because these are intended to
 // be fatal.
-static inline void expand_buffer(List* lst) {
+static inline void expand_buffer(List* lst, int bytes) {
 
-    if(lst->len + lst->size > lst->cap) {
-        while(lst->len + lst->size > lst->cap)
+    if(lst->len + bytes > lst->cap) {
+        while(lst->len + bytes > lst->cap)
             lst->cap <<= 1;
-        lst->buffer = _REALLOC(lst->buffer, lst->size * lst->cap);
+        lst->buffer = _REALLOC(lst->buffer, lst->cap);
     }
 }
 
@@ -39,10 +39,10 @@ List* create_list(int size) {
 
     List* ptr = _ALLOC_T(List);
 
-    ptr->cap = 1 << 3;
+    ptr->cap = size << 3;
     ptr->len = 0;
     ptr->size = size;
-    ptr->buffer = _ALLOC(ptr->size * ptr->cap);
+    ptr->buffer = _ALLOC(ptr->cap);
     ptr->changed = false;
 
     return ptr;
@@ -59,13 +59,30 @@ void destroy_list(List* lst) {
 // append a datum to the list
 void append_list(List* lst, void* data) {
 
-    expand_buffer(lst);
+    expand_buffer(lst, lst->size);
 
     memcpy(&lst->buffer[lst->len], data, lst->size);
     lst->len += lst->size;
     lst->changed = true;
 }
 
+// Make sure that there is room for count more items without another
+// allocation.
+void reserve_list(List* lst, int count) {
+
+    expand_buffer(lst, count * lst->size);
+}
+
+// append count items from an array with a single copy
+void extend_list(List* lst, void* data, int count) {
+
+    expand_buffer(lst, count * lst->size);
+
+    memcpy(&lst->buffer[lst->len], data, count * lst->size);
+    lst->len += count * lst->size;
+    lst->changed = true;
+}
+
 void read_list(List* lst, int index, void* data) {
 
     int idx = normalize_index(lst, index);
@@ -82,12 +99,12 @@ void insert_list(List* lst, int index, void* data) {
 
     // aid in debugging
     int start, end, size;
-    start = lst->size * normalize_index(lst, index);
+    start = normalize_index(lst, index);
     end = start + lst->size;
     size = lst->len - start;
 
     if((lst->size * index) < lst->len) {
-        expand_buffer(lst);
+        expand_buffer(lst, lst->size);
 
         // make room
         memmove(&lst->buffer[end], &lst->buffer[start], size);
@@ -105,7 +122,7 @@ void delete_list(List* lst, int index) {
 
     // aid in debugging
     int start, end, size;
-    start = lst->size * normalize_index(lst, index);
+    start = normalize_index(lst, index);
     end = start + lst->size;
     size = lst->len - end;
 
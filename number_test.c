@@ -0,0 +1,109 @@
+
+#include <float.h>
+#include <math.h>
+
+#include "util.h"
+
+static const char* result_name(NumResult res) {
+
+    switch(res) {
+        case NUM_OK: return "ok";
+        case NUM_EMPTY: return "empty";
+        case NUM_INVALID: return "invalid";
+        case NUM_RANGE: return "range";
+    }
+    return "unknown";
+}
+
+void show_int(const char* text, int base) {
+
+    long val = 0;
+    NumResult res = parse_int_view(view_str(text), base, &val);
+    printf("int(%d) \"%s\": %s %ld\n", base, text, result_name(res), val);
+}
+
+void show_uint(const char* text, int base) {
+
+    unsigned long val = 0;
+    NumResult res = parse_uint_view(view_str(text), base, &val);
+    printf("uint(%d) \"%s\": %s %lu\n", base, text, result_name(res), val);
+}
+
+void show_double(const char* text) {
+
+    double val = 0;
+    NumResult res = parse_double_view(view_str(text), &val);
+    printf("double \"%s\": %s %.17g", text, result_name(res), val);
+    if(res == NUM_OK)
+        printf(" (strtod %s)", (val == strtod(text, NULL)) ? "same" : "DIFFERENT");
+    printf("\n");
+}
+
+int main() {
+
+    printf("format\n");
+    Str* s = create_string(NULL);
+    long ints[] = { 0, 7, -7, 42, 99, 100, -12345, 1234567890123L, LONG_MAX, LONG_MIN };
+    for(int i = 0; i < (int)(sizeof(ints) / sizeof(ints[0])); i++) {
+        add_string_int(s, ints[i]);
+        add_string_char(s, ' ');
+    }
+    add_string_uint(s, ULONG_MAX);
+    add_string_char(s, ' ');
+    add_string_hex(s, 0);
+    add_string_char(s, ' ');
+    add_string_hex(s, 0xdeadbeefUL);
+    printf("%s\n", raw_string(s));
+
+    clear_string(s);
+    double dbls[] = { 0.0,     -0.0,    1.0,  -2.5, 0.1,       1.0 / 3.0, 1e100,   5e-324,
+                      DBL_MIN, DBL_MAX, 1e16, 1e23, 0.0001234, 9.5e-5,    2.0e300, 123456789012.5,
+                      0.3,     NAN,     -INFINITY };
+    for(int i = 0; i < (int)(sizeof(dbls) / sizeof(dbls[0])); i++) {
+        add_string_double(s, dbls[i]);
+        add_string_char(s, ' ');
+    }
+    printf("%s\n", raw_string(s));
+
+    printf("\nround trip\n");
+    int bad = 0;
+    for(int i = 0; i < 10000; i++) {
+        double d = (rand() - RAND_MAX / 2) * pow(10, (rand() % 40) - 20) / (rand() + 1.0);
+        double back;
+        clear_string(s);
+        add_string_double(s, d);
+        if(parse_double_view(view_Str(s), &back) != NUM_OK || back != d)
+            bad++;
+    }
+    printf("doubles that did not read back: %d\n", bad);
+
+    printf("\nparse\n");
+    show_int("12345", 10);
+    show_int("-9223372036854775808", 10);
+    show_int("9223372036854775808", 10);
+    show_int("+17", 10);
+    show_int("12a", 10);
+    show_int("", 10);
+    show_int("-", 10);
+    show_int("-0x10", 0);
+    show_int("0x10", 10);
+    show_uint("0xFF", 0);
+    show_uint("255", 0);
+    show_uint("ff", 16);
+    show_uint("18446744073709551616", 10);
+    show_double("3.25");
+    show_double("-0.001");
+    show_double("1e22");
+    show_double("1.7976931348623157e308");
+    show_double("0.1234567890123456789012");
+    show_double("1e-400");
+    show_double(".5");
+    show_double("5.");
+    show_double("1e");
+    show_double("x");
+    show_double("1e999");
+
+    destroy_string(s);
+
+    return 0;
+}
@@ -0,0 +1,288 @@
+/*
+ * Minimal perfect hash for a fixed set of keys. This uses the "hash,
+ * displace and compress" method. The keys are hashed into buckets of about
+ * PERFECT_LAMBDA keys. The buckets are placed biggest first, and for every
+ * bucket a displacement is found that moves all of its keys to slots that
+ * are still free. Only the displacements are needed to find the slot of a
+ * key, and there are as many slots as keys.
+ *
+ * A key that is not in the set also maps to a slot, so the key in the slot
+ * is compared. That makes a lookup one hash, one displacement and one
+ * compare, with no probing.
+ */
+#include "util.h"
+
+// The same bucket that perfect_hash_slot() uses.
+static inline uint32_t bucket_of(uint64_t hash, uint32_t nbuckets) {
+
+    return (uint32_t)(((hash >> 32) * nbuckets) >> 32);
+}
+
+static inline bool view_equal(StrView a, StrView b) {
+
+    return a.len == b.len && memcmp(a.ptr, b.ptr, a.len) == 0;
+}
+
+// Find a displacement for every bucket, biggest buckets first, and set the
+// slot of every key. Returns false if a bucket could not be placed, which
+// is fixed by a new seed, or if two keys are the same, which sets dup.
+static bool place_keys(PerfectHash* ph, const StrView* keys, const uint64_t* hashes, int* slots,
+                       bool* dup) {
+
+    int count = ph->count;
+    int nbuckets = ph->nbuckets;
+    int* start = _ALLOC_ARRAY(int, nbuckets + 1);
+    int* fill = _ALLOC_ARRAY(int, nbuckets);
+    int* order = _ALLOC_ARRAY(int, count);
+    int* sorted = _ALLOC_ARRAY(int, nbuckets);
+    uint8_t* taken = _ALLOC(count);
+    bool ok = true;
+
+    // group the keys by bucket
+    for(int i = 0; i < count; i++)
+        start[bucket_of(hashes[i], nbuckets) + 1]++;
+    int most = 0;
+    for(int b = 0; b < nbuckets; b++) {
+        most = (start[b + 1] > most) ? start[b + 1] : most;
+        start[b + 1] += start[b];
+        fill[b] = start[b];
+    }
+    for(int i = 0; i < count; i++)
+        order[fill[bucket_of(hashes[i], nbuckets)]++] = i;
+
+    // sort the buckets by size, biggest first
+    int* pos = _ALLOC_ARRAY(int, most + 2);
+    for(int b = 0; b < nbuckets; b++)
+        pos[most - (start[b + 1] - start[b]) + 1]++;
+    for(int s = 0; s <= most; s++)
+        pos[s + 1] += pos[s];
+    for(int b = 0; b < nbuckets; b++)
+        sorted[pos[most - (start[b + 1] - start[b])]++] = b;
+    _FREE(pos);
+
+    for(int i = 0; i < nbuckets && ok; i++) {
+        int b = sorted[i];
+        int first = start[b];
+        int len = start[b + 1] - first;
+
+        if(len == 0)
+            break;
+
+        // keys with the same hash have the same slot for every displacement
+        for(int j = 0; j < len && ok; j++) {
+            for(int k = j + 1; k < len && ok; k++) {
+                int kj = order[first + j];
+                int kk = order[first + k];
+                if(hashes[kj] == hashes[kk]) {
+                    *dup = view_equal(keys[kj], keys[kk]);
+                    ok = false;
+                }
+            }
+        }
+
+        uint32_t d;
+        for(d = 0; d < PERFECT_TRIES && ok; d++) {
+            int j;
+            ph->disp[b] = d;
+            for(j = 0; j < len; j++) {
+                int key = order[first + j];
+                uint32_t slot = perfect_hash_slot(hashes[key], ph->disp, nbuckets, count);
+                if(taken[slot])
+                    break;
+                taken[slot] = 1;
+                slots[key] = slot;
+            }
+            if(j == len)
+                break;
+            while(j-- > 0)
+                taken[slots[order[first + j]]] = 0;
+        }
+        if(d == PERFECT_TRIES)
+            ok = false;
+    }
+
+    _FREE(start);
+    _FREE(fill);
+    _FREE(order);
+    _FREE(sorted);
+    _FREE(taken);
+
+    return ok;
+}
+
+// Build the table for the keys. The index of a key in the list is what a
+// lookup returns. Returns NULL if a key is in the list more than once.
+PerfectHash* create_perfect_hash_views(const StrView* keys, int count) {
+
+    assert(count >= 0);
+
+    PerfectHash* ph = _ALLOC_T(PerfectHash);
+    ph->count = count;
+    ph->nbuckets = count / PERFECT_LAMBDA + 1;
+    ph->disp = _ALLOC_ARRAY(uint32_t, ph->nbuckets);
+
+    uint64_t* hashes = _ALLOC_ARRAY(uint64_t, count);
+    int* slots = _ALLOC_ARRAY(int, count);
+    uint64_t seed = get_hash_seed();
+    bool dup = false;
+    bool ok = false;
+
+    for(int n = 0; n < PERFECT_SEEDS && !ok && !dup; n++) {
+        ph->seed = seed + n * 0x9E3779B97F4A7C15ull;
+        for(int i = 0; i < count; i++)
+            hashes[i] = hash_bytes64(keys[i].ptr, keys[i].len, ph->seed);
+        memset(ph->disp, 0, sizeof(uint32_t) * ph->nbuckets);
+        ok = place_keys(ph, keys, hashes, slots, &dup);
+    }
+
+    if(ok) {
+        size_t total = 0;
+        for(int i = 0; i < count; i++)
+            total += keys[i].len + 1;
+
+        ph->pool = _ALLOC(total);
+        ph->keys = _ALLOC_ARRAY(const char*, count);
+        ph->lens = _ALLOC_ARRAY(uint32_t, count);
+        ph->index = _ALLOC_ARRAY(int, count);
+
+        char* ptr = ph->pool;
+        for(int i = 0; i < count; i++) {
+            int slot = slots[i];
+            memcpy(ptr, keys[i].ptr, keys[i].len);
+            ptr[keys[i].len] = '\0';
+            ph->keys[slot] = ptr;
+            ph->lens[slot] = keys[i].len;
+            ph->index[slot] = i;
+            ptr += keys[i].len + 1;
+        }
+    }
+    else {
+        _FREE(ph->disp);
+        _FREE(ph);
+        ph = NULL;
+    }
+
+    _FREE(hashes);
+    _FREE(slots);
+
+    return ph;
+}
+
+PerfectHash* create_perfect_hash(const char** keys, int count) {
+
+    StrView* views = _ALLOC_ARRAY(StrView, count);
+    for(int i = 0; i < count; i++)
+        views[i] = view_str(keys[i]);
+
+    PerfectHash* ph = create_perfect_hash_views(views, count);
+    _FREE(views);
+
+    return ph;
+}
+
+void destroy_perfect_hash(PerfectHash* ph) {
+
+    if(ph != NULL) {
+        _FREE(ph->disp);
+        _FREE(ph->keys);
+        _FREE(ph->lens);
+        _FREE(ph->index);
+        _FREE(ph->pool);
+        _FREE(ph);
+    }
+}
+
+// Returns the index of the key in the list that the table was built from,
+// or -1 if it is not one of the keys.
+int find_perfect_hash_view(PerfectHash* ph, StrView key) {
+
+    if(ph->count == 0)
+        return -1;
+
+    uint32_t slot = perfect_hash_slot(hash_bytes64(key.ptr, key.len, ph->seed), ph->disp,
+                                      ph->nbuckets, ph->count);
+
+    return (ph->lens[slot] == (uint32_t)key.len && memcmp(ph->keys[slot], key.ptr, key.len) == 0)
+               ? ph->index[slot]
+               : -1;
+}
+
+int find_perfect_hash(PerfectHash* ph, const char* key) {
+
+    return find_perfect_hash_view(ph, view_str(key));
+}
+
+static void emit_key(FILE* fp, const char* key, uint32_t len) {
+
+    fputc('"', fp);
+    for(uint32_t i = 0; i < len; i++) {
+        unsigned char ch = key[i];
+        if(ch >= ' ' && ch <= '~' && ch != '"' && ch != '\\' && ch != '?')
+            fputc(ch, fp);
+        else
+            fprintf(fp, "\\%03o", ch);
+    }
+    fputc('"', fp);
+}
+
+static void emit_numbers(FILE* fp, const char* type, const char* name, const char* table,
+                         const void* data, bool is_signed, int count) {
+
+    fprintf(fp, "static const %s %s_%s[%d] = {", type, name, table, (count > 0) ? count : 1);
+    for(int i = 0; i < count; i++) {
+        fprintf(fp, (i % 8 == 0) ? "\n    " : " ");
+        if(is_signed)
+            fprintf(fp, "%d,", ((const int*)data)[i]);
+        else
+            fprintf(fp, "%uu,", ((const uint32_t*)data)[i]);
+    }
+    fprintf(fp, "%s};\n\n", (count > 0) ? "\n" : " 0 ");
+}
+
+// Write the table as a C header, so that a program can have it built in
+// instead of building it when it starts. The header defines the function
+// "int <name>_lookup(const char* key, size_t len)" that returns the same
+// thing as find_perfect_hash(). It uses hash_bytes64(), so the program
+// must still be linked with this library.
+void emit_perfect_hash(PerfectHash* ph, FILE* fp, const char* name) {
+
+    char guard[128];
+    int len = 0;
+    for(; name[len] != '\0' && len < (int)sizeof(guard) - 1; len++)
+        guard[len] = toupper((unsigned char)name[len]);
+    guard[len] = '\0';
+
+    fprintf(fp, "// Generated by emit_perfect_hash(). Do not edit.\n");
+    fprintf(fp, "#ifndef _%s_PERFECT_H_\n#define _%s_PERFECT_H_\n\n", guard, guard);
+    fprintf(fp, "#include \"util.h\"\n\n");
+
+    emit_numbers(fp, "uint32_t", name, "disp", ph->disp, false, ph->nbuckets);
+    emit_numbers(fp, "uint32_t", name, "lens", ph->lens, false, ph->count);
+    emit_numbers(fp, "int", name, "index", ph->index, true, ph->count);
+
+    fprintf(fp, "static const char* const %s_keys[%d] = {\n", name,
+            (ph->count > 0) ? ph->count : 1);
+    for(int i = 0; i < ph->count; i++) {
+        fprintf(fp, "    ");
+        emit_key(fp, ph->keys[i], ph->lens[i]);
+        fprintf(fp, ",\n");
+    }
+    if(ph->count == 0)
+        fprintf(fp, "    \"\",\n");
+    fprintf(fp, "};\n\n");
+
+    fprintf(fp, "static inline int %s_lookup(const char* key, size_t len) {\n\n", name);
+    if(ph->count > 0) {
+        fprintf(fp,
+                "    uint32_t slot = perfect_hash_slot(hash_bytes64(key, len, 0x%016llxull), "
+                "%s_disp, %d, %d);\n\n",
+                (unsigned long long)ph->seed, name, ph->nbuckets, ph->count);
+        fprintf(fp,
+                "    return (%s_lens[slot] == len && memcmp(%s_keys[slot], key, len) == 0) ? "
+                "%s_index[slot] : -1;\n",
+                name, name, name);
+    }
+    else
+        fprintf(fp, "    (void)key;\n    (void)len;\n    return -1;\n");
+    fprintf(fp, "}\n\n#endif /* _%s_PERFECT_H_ */\n", guard);
+}
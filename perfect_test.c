@@ -0,0 +1,69 @@
+#include "util.h"
+
+int main() {
+
+    // the same hashes every time, so the output can be compared
+    set_hash_seed(1);
+
+    const char* keywords[] = { "auto",     "break",  "case",     "char",   "const",    "continue",
+                               "default",  "do",     "double",   "else",   "enum",     "extern",
+                               "float",    "for",    "goto",     "if",     "int",      "long",
+                               "register", "return", "short",    "signed", "sizeof",   "static",
+                               "struct",   "switch", "typedef",  "union",  "unsigned", "void",
+                               "volatile", "while" };
+    int count = sizeof(keywords) / sizeof(keywords[0]);
+
+    printf("build the keywords\n");
+    PerfectHash* ph = create_perfect_hash(keywords, count);
+    printf("keys: %d buckets: %d\n", ph->count, ph->nbuckets);
+
+    int found = 0;
+    for(int i = 0; i < count; i++)
+        if(find_perfect_hash(ph, keywords[i]) == i)
+            found++;
+    printf("found: %d\n", found);
+
+    printf("while: %d\n", find_perfect_hash(ph, "while"));
+    printf("until: %d\n", find_perfect_hash(ph, "until"));
+    printf("whil: %d\n", find_perfect_hash_view(ph, view_bytes("whiled", 4)));
+    printf("while view: %d\n", find_perfect_hash_view(ph, view_bytes("whiled", 5)));
+    printf("empty: %d\n\n", find_perfect_hash(ph, ""));
+    destroy_perfect_hash(ph);
+
+    printf("duplicate keys\n");
+    const char* dups[] = { "abc", "def", "abc" };
+    ph = create_perfect_hash(dups, 3);
+    printf("table: %s\n\n", (ph == NULL) ? "NULL" : "built");
+
+    printf("no keys\n");
+    ph = create_perfect_hash(NULL, 0);
+    printf("abc: %d\n\n", find_perfect_hash(ph, "abc"));
+    destroy_perfect_hash(ph);
+
+    printf("a lot of keys\n");
+    int many = 100000;
+    StrView* views = _ALLOC_ARRAY(StrView, many);
+    char* buf = _ALLOC(many * 16);
+    for(int i = 0; i < many; i++) {
+        int len = snprintf(&buf[i * 16], 16, "key_%d", i);
+        views[i] = view_bytes(&buf[i * 16], len);
+    }
+    ph = create_perfect_hash_views(views, many);
+    found = 0;
+    for(int i = 0; i < many; i++)
+        if(find_perfect_hash_view(ph, views[i]) == i)
+            found++;
+    printf("keys: %d found: %d\n", ph->count, found);
+    printf("missing: %d\n\n", find_perfect_hash(ph, "key_100000"));
+    destroy_perfect_hash(ph);
+    _FREE(views);
+    _FREE(buf);
+
+    printf("emit a header\n");
+    const char* opts[] = { "-h", "--help", "-o", "\"quoted\"" };
+    ph = create_perfect_hash(opts, 4);
+    emit_perfect_hash(ph, stdout, "opts");
+    destroy_perfect_hash(ph);
+
+    return 0;
+}
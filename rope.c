@@ -0,0 +1,313 @@
+/*
+ * Rope. Text that is edited in the middle a lot is kept as a balanced
+ * tree of chunks instead of one flat buffer, so an insert or a delete
+ * does not have to move the rest of the text. The tree is a treap that
+ * is ordered by position: every node holds a chunk of up to ROPE_CHUNK
+ * bytes and the total length of its subtree, and the random priorities
+ * keep the depth at O(log n) on average.
+ *
+ * All of the edits are made with two operations. Split cuts the tree in
+ * two at a character position, splitting a chunk if it has to. Merge
+ * joins two trees where all of the text in the first comes before the
+ * text in the second. Both are O(log n).
+ *
+ * Small inserts are copied into the end of the chunk just before the
+ * insert point when there is room, so typing one character at a time
+ * does not create a node for every character.
+ */
+#include "util.h"
+
+struct _rope_node_ {
+    struct _rope_node_* left;
+    struct _rope_node_* right;
+    uint32_t priority; // treap priority, a parent is never lower than a child
+    int size;          // number of characters in this subtree
+    int len;           // number of characters in this chunk
+    char text[ROPE_CHUNK];
+};
+
+typedef struct _rope_node_ RopeNode;
+
+static inline int node_size(RopeNode* node) {
+
+    return (node != NULL) ? node->size : 0;
+}
+
+static inline void update_node(RopeNode* node) {
+
+    node->size = node_size(node->left) + node->len + node_size(node->right);
+}
+
+// xorshift, good enough for treap priorities
+static uint32_t next_priority(Rope* rope) {
+
+    uint32_t x = rope->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rope->seed = x;
+
+    return x;
+}
+
+static RopeNode* create_node(Rope* rope, const char* text, int len) {
+
+    assert(len <= ROPE_CHUNK);
+
+    RopeNode* node = _ALLOC_T(RopeNode);
+    node->left = NULL;
+    node->right = NULL;
+    node->priority = next_priority(rope);
+    node->len = len;
+    memcpy(node->text, text, len);
+    update_node(node);
+
+    return node;
+}
+
+static void destroy_node(RopeNode* node) {
+
+    if(node != NULL) {
+        destroy_node(node->left);
+        destroy_node(node->right);
+        _FREE(node);
+    }
+}
+
+static RopeNode* merge(RopeNode* a, RopeNode* b) {
+
+    if(a == NULL)
+        return b;
+    if(b == NULL)
+        return a;
+
+    if(a->priority >= b->priority) {
+        a->right = merge(a->right, b);
+        update_node(a);
+        return a;
+    }
+    else {
+        b->left = merge(a, b->left);
+        update_node(b);
+        return b;
+    }
+}
+
+// Split the tree so that the first pos characters are in left and the rest
+// are in right.
+static void split(Rope* rope, RopeNode* node, int pos, RopeNode** left, RopeNode** right) {
+
+    if(node == NULL) {
+        *left = *right = NULL;
+        return;
+    }
+
+    int lsize = node_size(node->left);
+
+    if(pos <= lsize) {
+        split(rope, node->left, pos, left, &node->left);
+        update_node(node);
+        *right = node;
+    }
+    else if(pos >= lsize + node->len) {
+        split(rope, node->right, pos - lsize - node->len, &node->right, right);
+        update_node(node);
+        *left = node;
+    }
+    else {
+        // the split is inside of this chunk. The tail gets the same priority
+        // so it can take over the right subtree.
+        int off = pos - lsize;
+        RopeNode* tail = create_node(rope, &node->text[off], node->len - off);
+        tail->priority = node->priority;
+        tail->right = node->right;
+        update_node(tail);
+
+        node->len = off;
+        node->right = NULL;
+        update_node(node);
+
+        *left = node;
+        *right = tail;
+    }
+}
+
+// Try to add the text to the end of the last chunk in the tree.
+static bool append_chunk(RopeNode* node, const char* text, int len) {
+
+    if(node == NULL)
+        return false;
+
+    bool done;
+    if(node->right != NULL)
+        done = append_chunk(node->right, text, len);
+    else if(node->len + len <= ROPE_CHUNK) {
+        memcpy(&node->text[node->len], text, len);
+        node->len += len;
+        done = true;
+    }
+    else
+        done = false;
+
+    if(done)
+        update_node(node);
+
+    return done;
+}
+
+// Build a tree from the text, one chunk at a time.
+static RopeNode* build_nodes(Rope* rope, const char* text, int len) {
+
+    RopeNode* root = NULL;
+
+    for(int i = 0; i < len; i += ROPE_CHUNK) {
+        int n = (len - i < ROPE_CHUNK) ? len - i : ROPE_CHUNK;
+        root = merge(root, create_node(rope, &text[i], n));
+    }
+
+    return root;
+}
+
+Rope* create_rope(const char* str) {
+
+    Rope* rope = _ALLOC_T(Rope);
+    rope->root = NULL;
+    rope->seed = 0x9E3779B9u;
+
+    if(str != NULL)
+        rope->root = build_nodes(rope, str, strlen(str));
+
+    return rope;
+}
+
+void destroy_rope(Rope* rope) {
+
+    if(rope != NULL) {
+        destroy_node(rope->root);
+        _FREE(rope);
+    }
+}
+
+int length_rope(Rope* rope) {
+
+    return node_size(rope->root);
+}
+
+// Return the character at the index.
+int char_rope(Rope* rope, int index) {
+
+    if(index < 0 || index >= length_rope(rope))
+        RAISE(LIST_ERROR, "List Error: index out of range: %d\n", index);
+
+    RopeNode* node = rope->root;
+    while(true) {
+        int lsize = node_size(node->left);
+        if(index < lsize)
+            node = node->left;
+        else if(index < lsize + node->len)
+            return (unsigned char)node->text[index - lsize];
+        else {
+            index -= lsize + node->len;
+            node = node->right;
+        }
+    }
+}
+
+void insert_rope_bytes(Rope* rope, int index, const char* text, int len) {
+
+    if(index < 0 || index > length_rope(rope))
+        RAISE(LIST_ERROR, "List Error: index out of range: %d\n", index);
+
+    if(len <= 0)
+        return;
+
+    RopeNode *left, *right;
+    split(rope, rope->root, index, &left, &right);
+
+    if(!append_chunk(left, text, len))
+        left = merge(left, build_nodes(rope, text, len));
+
+    rope->root = merge(left, right);
+}
+
+void insert_rope_str(Rope* rope, int index, const char* str) {
+
+    insert_rope_bytes(rope, index, str, strlen(str));
+}
+
+void append_rope(Rope* rope, const char* text, int len) {
+
+    insert_rope_bytes(rope, length_rope(rope), text, len);
+}
+
+// Remove len characters starting at the index.
+void delete_rope(Rope* rope, int index, int len) {
+
+    if(index < 0 || len < 0 || index + len > length_rope(rope))
+        RAISE(LIST_ERROR, "List Error: invalid range in delete rope: %d, %d\n", index, len);
+
+    RopeNode *left, *middle, *right;
+    split(rope, rope->root, index, &left, &right);
+    split(rope, right, len, &middle, &right);
+    destroy_node(middle);
+
+    rope->root = merge(left, right);
+}
+
+// Move all of the text in src to the end of dest. The src is left empty.
+void concat_rope(Rope* dest, Rope* src) {
+
+    dest->root = merge(dest->root, src->root);
+    src->root = NULL;
+}
+
+// Copy the text into a new Str.
+Str* flatten_rope(Rope* rope) {
+
+    Str* str = create_string(NULL);
+    reserve_string(str, length_rope(rope));
+
+    RopeIter* iter = init_rope_iterator(rope);
+    StrView chunk;
+    while(iterate_rope(iter, &chunk))
+        add_string_view(str, chunk);
+    destroy_list(iter->stack);
+    _FREE(iter);
+
+    return str;
+}
+
+static void push_left(RopeIter* iter, RopeNode* node) {
+
+    while(node != NULL) {
+        push_ptr_list(iter->stack, node);
+        node = node->left;
+    }
+}
+
+RopeIter* init_rope_iterator(Rope* rope) {
+
+    RopeIter* iter = _ALLOC_T(RopeIter);
+    iter->stack = create_ptr_list();
+    push_left(iter, rope->root);
+
+    return iter;
+}
+
+// Return the chunks in order as views. The views are good until the rope
+// is changed.
+bool iterate_rope(RopeIter* iter, StrView* chunk) {
+
+    while(length_list(iter->stack) > 0) {
+        RopeNode* node = peek_ptr_list(iter->stack);
+        pop_list(iter->stack, NULL);
+        push_left(iter, node->right);
+
+        if(node->len > 0) {
+            *chunk = view_bytes(node->text, node->len);
+            return true;
+        }
+    }
+
+    return false;
+}
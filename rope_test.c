@@ -0,0 +1,80 @@
+
+#include "util.h"
+
+// Make the same edits to a rope and to a plain buffer and compare them.
+int main() {
+
+    Rope* rope = create_rope("The quick brown fox jumps over the lazy dog.");
+    Str* s = flatten_rope(rope);
+    printf("%s (%d)\n", raw_string(s), length_rope(rope));
+
+    printf("\nedits\n");
+    insert_rope_str(rope, 4, "very ");
+    delete_rope(rope, 15, 6);
+    insert_rope_str(rope, length_rope(rope), " The end.");
+    insert_rope_str(rope, 0, ">> ");
+    s = flatten_rope(rope);
+    printf("%s (%d)\n", raw_string(s), length_rope(rope));
+    printf("char 3: %c\n", char_rope(rope, 3));
+
+    printf("\nconcatenate\n");
+    Rope* other = create_rope(" More text.");
+    concat_rope(rope, other);
+    s = flatten_rope(rope);
+    printf("%s (%d) other: %d\n", raw_string(s), length_rope(rope), length_rope(other));
+
+    printf("\nrandom edits on a large text\n");
+    int size = 100000;
+    char* ref = _ALLOC(size * 2);
+    for(int i = 0; i < size; i++)
+        ref[i] = 'a' + (i % 26);
+    int len = size;
+
+    Rope* big = create_rope(NULL);
+    append_rope(big, ref, len);
+
+    unsigned int seed = 1;
+    for(int i = 0; i < 5000; i++) {
+        seed = seed * 1103515245 + 12345;
+        int pos = (seed >> 8) % (len + 1);
+        if(i % 3 == 2 && len > 10) {
+            int n = (seed >> 4) % 10;
+            if(pos + n > len)
+                n = len - pos;
+            delete_rope(big, pos, n);
+            memmove(&ref[pos], &ref[pos + n], len - pos - n);
+            len -= n;
+        }
+        else {
+            const char* txt = (i % 2) ? "X" : "insert";
+            int n = strlen(txt);
+            insert_rope_bytes(big, pos, txt, n);
+            memmove(&ref[pos + n], &ref[pos], len - pos);
+            memcpy(&ref[pos], txt, n);
+            len += n;
+        }
+    }
+
+    s = flatten_rope(big);
+    printf("length: %d expected: %d same: %s\n", length_rope(big), len,
+           (length_string(s) == len && memcmp(raw_string(s), ref, len) == 0) ? "yes" : "no");
+
+    int errors = 0;
+    for(int i = 0; i < len; i += 97)
+        if(char_rope(big, i) != (unsigned char)ref[i])
+            errors++;
+    printf("index errors: %d\n", errors);
+
+    int chunks = 0;
+    StrView chunk;
+    RopeIter* iter = init_rope_iterator(big);
+    while(iterate_rope(iter, &chunk))
+        chunks++;
+    printf("chunks: %s\n", (chunks > 0 && chunks < len) ? "ok" : "bad");
+
+    destroy_rope(big);
+    destroy_rope(rope);
+    destroy_rope(other);
+
+    return 0;
+}
@@ -0,0 +1,205 @@
+/*
+ * Slot map. Items are stored densely in a List, so iterating them is a
+ * scan over contiguous memory. Callers refer to an item with a handle
+ * that holds a slot index and a generation. The slot points at the
+ * item's current position in the dense list. Erasing an item moves the
+ * last item into the hole, so both insert and erase are O(1) and the
+ * handles of the other items stay valid.
+ *
+ * When a slot is freed its generation is incremented. A handle to an
+ * erased item then no longer matches the slot and is detected as stale,
+ * even after the slot has been reused.
+ */
+#include "util.h"
+
+typedef struct {
+    uint32_t index;      // dense index when in use, next free slot when not
+    uint32_t generation; // incremented every time the slot is freed
+} _slot;
+
+#define NO_SLOT 0xFFFFFFFFu
+
+static inline SlotHandle make_handle(uint32_t index, uint32_t generation) {
+
+    return ((SlotHandle)generation << 32) | index;
+}
+
+static inline uint32_t handle_index(SlotHandle h) {
+
+    return (uint32_t)(h & 0xFFFFFFFFu);
+}
+
+static inline uint32_t handle_generation(SlotHandle h) {
+
+    return (uint32_t)(h >> 32);
+}
+
+// Return the slot for the handle, or NULL if the handle is stale.
+static inline _slot* find_slot(SlotMap* map, SlotHandle h) {
+
+    uint32_t idx = handle_index(h);
+
+    if(idx < (uint32_t)length_list(map->slots)) {
+        _slot* slot = (_slot*)raw_list(map->slots) + idx;
+        if(slot->generation == handle_generation(h))
+            return slot;
+    }
+
+    return NULL;
+}
+
+SlotMap* create_slot_map(int size) {
+
+    SlotMap* ptr = _ALLOC_T(SlotMap);
+    ptr->data = create_list(size);
+    ptr->owners = create_list(sizeof(uint32_t));
+    ptr->slots = create_list(sizeof(_slot));
+    ptr->free_head = NO_SLOT;
+
+    return ptr;
+}
+
+void destroy_slot_map(SlotMap* map) {
+
+    if(map != NULL) {
+        destroy_list(map->data);
+        destroy_list(map->owners);
+        destroy_list(map->slots);
+        _FREE(map);
+    }
+}
+
+SlotHandle insert_slot_map(SlotMap* map, void* data) {
+
+    uint32_t dense = (uint32_t)length_list(map->data);
+    uint32_t idx;
+    _slot* slot;
+
+    if(map->free_head != NO_SLOT) {
+        idx = map->free_head;
+        slot = (_slot*)raw_list(map->slots) + idx;
+        map->free_head = slot->index;
+    }
+    else {
+        _slot tmp = { 0, 1 }; // generation 0 is never valid
+        idx = (uint32_t)length_list(map->slots);
+        append_list(map->slots, &tmp);
+        slot = (_slot*)raw_list(map->slots) + idx;
+    }
+
+    slot->index = dense;
+    append_list(map->data, data);
+    append_list(map->owners, &idx);
+
+    return make_handle(idx, slot->generation);
+}
+
+// Erase the item. The last item in the dense list is moved into its place.
+bool erase_slot_map(SlotMap* map, SlotHandle h) {
+
+    _slot* slot = find_slot(map, h);
+    if(slot == NULL)
+        return false;
+
+    uint32_t dense = slot->index;
+    uint32_t last = (uint32_t)length_list(map->data) - 1;
+    uint32_t* owners = (uint32_t*)raw_list(map->owners);
+
+    if(dense != last) {
+        unsigned char* buf = (unsigned char*)raw_list(map->data);
+        memcpy(&buf[dense * map->data->size], &buf[last * map->data->size], map->data->size);
+        owners[dense] = owners[last];
+        ((_slot*)raw_list(map->slots))[owners[dense]].index = dense;
+    }
+
+    pop_list(map->data, NULL);
+    pop_list(map->owners, NULL);
+
+    slot->generation++;
+    if(slot->generation == 0)
+        slot->generation = 1;
+    slot->index = map->free_head;
+    map->free_head = handle_index(h);
+
+    return true;
+}
+
+// Return a pointer to the item in the dense list, or NULL if the handle is
+// stale. The pointer is only good until the next insert or erase.
+void* lookup_slot_map(SlotMap* map, SlotHandle h) {
+
+    _slot* slot = find_slot(map, h);
+    if(slot == NULL)
+        return NULL;
+
+    return (unsigned char*)raw_list(map->data) + (slot->index * map->data->size);
+}
+
+bool read_slot_map(SlotMap* map, SlotHandle h, void* data) {
+
+    void* ptr = lookup_slot_map(map, h);
+    if(ptr == NULL)
+        return false;
+
+    memcpy(data, ptr, map->data->size);
+    return true;
+}
+
+bool write_slot_map(SlotMap* map, SlotHandle h, void* data) {
+
+    void* ptr = lookup_slot_map(map, h);
+    if(ptr == NULL)
+        return false;
+
+    memcpy(ptr, data, map->data->size);
+    return true;
+}
+
+bool valid_slot_map(SlotMap* map, SlotHandle h) {
+
+    return find_slot(map, h) != NULL;
+}
+
+// Get the handle of the item at the given dense index. Used together with
+// raw_slot_map() to find the handle of an item while iterating.
+SlotHandle handle_slot_map(SlotMap* map, int index) {
+
+    if(index < 0 || index >= length_list(map->data))
+        RAISE(LIST_ERROR, "List Error: index out of range: %d", index);
+
+    uint32_t idx = ((uint32_t*)raw_list(map->owners))[index];
+    _slot* slot = (_slot*)raw_list(map->slots) + idx;
+
+    return make_handle(idx, slot->generation);
+}
+
+void clear_slot_map(SlotMap* map) {
+
+    // free the slots that are in use so their handles become stale
+    int len = length_list(map->owners);
+    uint32_t* owners = (uint32_t*)raw_list(map->owners);
+    _slot* slots = (_slot*)raw_list(map->slots);
+
+    for(int i = 0; i < len; i++) {
+        _slot* slot = &slots[owners[i]];
+        slot->generation++;
+        if(slot->generation == 0)
+            slot->generation = 1;
+        slot->index = map->free_head;
+        map->free_head = owners[i];
+    }
+
+    clear_list(map->data);
+    clear_list(map->owners);
+}
+
+// Get the dense list of items for iteration.
+void* raw_slot_map(SlotMap* map) {
+
+    return raw_list(map->data);
+}
+
+int length_slot_map(SlotMap* map) {
+
+    return length_list(map->data);
+}
@@ -0,0 +1,63 @@
+
+#include "util.h"
+
+void dump(SlotMap* map) {
+
+    int* items = raw_slot_map(map);
+
+    printf("len: %d\n", length_slot_map(map));
+    for(int i = 0; i < length_slot_map(map); i++)
+        printf("%3d. handle: 0x%016lX value: %d\n", i, handle_slot_map(map, i), items[i]);
+    printf("\n");
+}
+
+int main() {
+
+    SlotMap* map = create_slot_map(sizeof(int));
+    SlotHandle handles[10];
+    int value;
+
+    printf("insert 10 items\n");
+    for(int i = 0; i < 10; i++) {
+        value = 1000 + i;
+        handles[i] = insert_slot_map(map, &value);
+    }
+    dump(map);
+
+    printf("erase items 0, 4 and 9\n");
+    printf("pass: %d\n", erase_slot_map(map, handles[0]));
+    printf("pass: %d\n", erase_slot_map(map, handles[4]));
+    printf("pass: %d\n", erase_slot_map(map, handles[9]));
+    // this is an error and has no effect on the map
+    printf("fail: %d\n", erase_slot_map(map, handles[4]));
+    dump(map);
+
+    printf("the other handles are still valid\n");
+    for(int i = 0; i < 10; i++) {
+        if(read_slot_map(map, handles[i], &value))
+            printf("handle %d: %d\n", i, value);
+        else
+            printf("handle %d: stale\n", i);
+    }
+    printf("\n");
+
+    printf("reuse a freed slot\n");
+    value = 2000;
+    SlotHandle h = insert_slot_map(map, &value);
+    printf("new handle: 0x%016lX old handle: 0x%016lX\n", h, handles[9]);
+    printf("old valid: %d new valid: %d\n", valid_slot_map(map, handles[9]),
+           valid_slot_map(map, h));
+
+    printf("write through the handle\n");
+    value = 3000;
+    write_slot_map(map, handles[5], &value);
+    printf("value: %d\n\n", *(int*)lookup_slot_map(map, handles[5]));
+
+    printf("clear the map\n");
+    clear_slot_map(map);
+    printf("len: %d valid: %d\n", length_slot_map(map), valid_slot_map(map, h));
+
+    destroy_slot_map(map);
+
+    return 0;
+}
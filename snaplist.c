@@ -0,0 +1,240 @@
+/*
+ * Snapshot list. This is a copy-on-write list for data that is read much
+ * more often than it is written. The contents are held in an immutable
+ * version. A writer copies the current version, changes the copy and then
+ * publishes it with a single atomic store. Readers take a snapshot, which
+ * is an atomic load of the current version, and can use it for as long as
+ * they like without locking and without seeing changes.
+ *
+ * Writers are serialized with a mutex. Readers never block.
+ *
+ * When using the GC, a replaced version is simply dropped and the GC
+ * reclaims it when the last snapshot that refers to it is gone. The GC only
+ * sees snapshots on the stacks of threads it knows about, so every thread
+ * that takes a snapshot must be registered with it, for example by defining
+ * GC_THREADS before including gc.h so that pthread_create() does it. Without
+ * the GC, epochs are used. Every published version advances the epoch
+ * and the replaced version is retired with the epoch it was replaced in.
+ * A reader records the epoch it started in, in a reader slot, for as long
+ * as it holds a snapshot. A retired version is freed when no reader slot
+ * holds an epoch that is not newer than the one it was retired in.
+ */
+#include "util.h"
+
+static SnapVersion* create_version(int size, int len, const void* data) {
+
+    SnapVersion* ver = (SnapVersion*)_ALLOC(sizeof(SnapVersion) + (size_t)size * len);
+    ver->next = NULL;
+    ver->retired = 0;
+    ver->len = len;
+    ver->size = size;
+    if(len > 0 && data != NULL)
+        memcpy(ver->buffer, data, (size_t)size * len);
+
+    return ver;
+}
+
+#ifndef USE_GC
+// Free every retired version that no reader can still be holding. Called
+// with the writer lock held.
+static void reclaim_versions(SnapList* lst) {
+
+    uint64_t oldest = UINT64_MAX;
+
+    for(int i = 0; i < SNAP_READERS; i++) {
+        uint64_t val = atomic_load(&lst->readers[i]);
+        if(val != 0 && val < oldest)
+            oldest = val;
+    }
+
+    SnapVersion** ptr = &lst->retired;
+    while(*ptr != NULL) {
+        SnapVersion* ver = *ptr;
+        if(ver->retired < oldest) {
+            *ptr = ver->next;
+            _FREE(ver);
+        }
+        else
+            ptr = &ver->next;
+    }
+}
+#endif
+
+// Replace the current version. Called with the writer lock held.
+static void publish_version(SnapList* lst, SnapVersion* ver) {
+
+    SnapVersion* old = atomic_exchange(&lst->current, ver);
+
+#ifdef USE_GC
+    (void)old;
+    atomic_fetch_add(&lst->epoch, 1);
+#else
+    old->retired = atomic_fetch_add(&lst->epoch, 1);
+    old->next = lst->retired;
+    lst->retired = old;
+    reclaim_versions(lst);
+#endif
+}
+
+// Returns -1 if the index is out of range.
+static inline int normalize_index(SnapVersion* ver, int index) {
+
+    int idx = (index < 0) ? ver->len + index : index;
+
+    return (idx < 0 || idx >= ver->len) ? -1 : idx;
+}
+
+SnapList* create_snap_list(int size) {
+
+    SnapList* ptr = _ALLOC_T(SnapList);
+
+    atomic_init(&ptr->current, create_version(size, 0, NULL));
+    atomic_init(&ptr->epoch, 1);
+    for(int i = 0; i < SNAP_READERS; i++)
+        atomic_init(&ptr->readers[i], 0);
+    ptr->retired = NULL;
+    ptr->size = size;
+    pthread_mutex_init(&ptr->lock, NULL);
+
+    return ptr;
+}
+
+// There must not be any snapshots held when this is called.
+void destroy_snap_list(SnapList* lst) {
+
+    if(lst != NULL) {
+        SnapVersion* ver = lst->retired;
+        while(ver != NULL) {
+            SnapVersion* next = ver->next;
+            _FREE(ver);
+            ver = next;
+        }
+        _FREE(atomic_load(&lst->current));
+        pthread_mutex_destroy(&lst->lock);
+        _FREE(lst);
+    }
+}
+
+void append_snap_list(SnapList* lst, void* data) {
+
+    pthread_mutex_lock(&lst->lock);
+
+    SnapVersion* old = atomic_load(&lst->current);
+    SnapVersion* ver = create_version(lst->size, old->len + 1, NULL);
+    memcpy(ver->buffer, old->buffer, (size_t)old->len * lst->size);
+    memcpy(&ver->buffer[(size_t)old->len * lst->size], data, lst->size);
+    publish_version(lst, ver);
+
+    pthread_mutex_unlock(&lst->lock);
+}
+
+void write_snap_list(SnapList* lst, int index, void* data) {
+
+    pthread_mutex_lock(&lst->lock);
+
+    SnapVersion* old = atomic_load(&lst->current);
+    int idx = normalize_index(old, index);
+    if(idx < 0) {
+        pthread_mutex_unlock(&lst->lock);
+        RAISE(LIST_ERROR, "List Error: index out of range: %d\n", index);
+    }
+
+    SnapVersion* ver = create_version(lst->size, old->len, old->buffer);
+    memcpy(&ver->buffer[(size_t)idx * lst->size], data, lst->size);
+    publish_version(lst, ver);
+
+    pthread_mutex_unlock(&lst->lock);
+}
+
+void delete_snap_list(SnapList* lst, int index) {
+
+    pthread_mutex_lock(&lst->lock);
+
+    SnapVersion* old = atomic_load(&lst->current);
+    int idx = normalize_index(old, index);
+    if(idx < 0) {
+        pthread_mutex_unlock(&lst->lock);
+        RAISE(LIST_ERROR, "List Error: index out of range: %d\n", index);
+    }
+
+    size_t size = lst->size;
+    SnapVersion* ver = create_version(lst->size, old->len - 1, NULL);
+    memcpy(ver->buffer, old->buffer, idx * size);
+    memcpy(&ver->buffer[idx * size], &old->buffer[(idx + 1) * size],
+           (old->len - idx - 1) * size);
+    publish_version(lst, ver);
+
+    pthread_mutex_unlock(&lst->lock);
+}
+
+void clear_snap_list(SnapList* lst) {
+
+    pthread_mutex_lock(&lst->lock);
+    publish_version(lst, create_version(lst->size, 0, NULL));
+    pthread_mutex_unlock(&lst->lock);
+}
+
+// Publish the contents of a List as the new version. This is used to make
+// many changes at once. The List must have the same item size.
+void publish_snap_list(SnapList* lst, List* src) {
+
+    assert(src->size == lst->size);
+
+    pthread_mutex_lock(&lst->lock);
+    publish_version(lst, create_version(lst->size, length_list(src), raw_list(src)));
+    pthread_mutex_unlock(&lst->lock);
+}
+
+// Take a snapshot of the current version. The snapshot does not change
+// when writers publish new versions. It must be released when the reader
+// is finished with it.
+void take_snap_list(SnapList* lst, SnapShot* snap) {
+
+    snap->list = lst;
+    snap->slot = -1;
+
+    // find a free reader slot and record the epoch
+    while(snap->slot < 0) {
+        uint64_t epoch = atomic_load(&lst->epoch);
+        for(int i = 0; i < SNAP_READERS; i++) {
+            uint64_t expect = 0;
+            if(atomic_compare_exchange_strong(&lst->readers[i], &expect, epoch)) {
+                snap->slot = i;
+                break;
+            }
+        }
+        if(snap->slot < 0)
+            sched_yield(); // all reader slots are in use
+    }
+
+    snap->version = atomic_load(&lst->current);
+}
+
+void release_snap_list(SnapShot* snap) {
+
+    if(snap->slot >= 0) {
+        atomic_store(&snap->list->readers[snap->slot], 0);
+        snap->slot = -1;
+        snap->version = NULL;
+    }
+}
+
+void read_snapshot(SnapShot* snap, int index, void* data) {
+
+    int idx = normalize_index(snap->version, index);
+    if(idx < 0)
+        RAISE(LIST_ERROR, "List Error: index out of range: %d\n", index);
+
+    memcpy(data, &snap->version->buffer[(size_t)idx * snap->version->size],
+           snap->version->size);
+}
+
+void* raw_snapshot(SnapShot* snap) {
+
+    return (void*)snap->version->buffer;
+}
+
+int length_snapshot(SnapShot* snap) {
+
+    return snap->version->len;
+}
@@ -0,0 +1,100 @@
+
+#ifdef USE_GC
+// the GC has to scan the stacks of the reader threads for their snapshots
+#define GC_THREADS
+#include <gc.h>
+#endif
+
+
+#include "util.h"
+
+#define NUM_READERS 4
+#define NUM_WRITES 2000
+
+static SnapList* lst;
+static atomic_int done;
+
+// Every version that is published holds the values 0..n-1, so a reader can
+// check that a snapshot is consistent while the writer keeps changing it.
+void* reader(void* arg) {
+
+    long errors = 0, snaps = 0;
+    (void)arg;
+
+    while(!atomic_load(&done)) {
+        SnapShot snap;
+        take_snap_list(lst, &snap);
+        int* items = raw_snapshot(&snap);
+        for(int i = 0; i < length_snapshot(&snap); i++)
+            if(items[i] != i)
+                errors++;
+        release_snap_list(&snap);
+        snaps++;
+    }
+
+    printf("reader: snapshots: %s errors: %ld\n", (snaps > 0) ? "yes" : "no", errors);
+    return NULL;
+}
+
+int main() {
+
+    pthread_t threads[NUM_READERS];
+    int value;
+
+    lst = create_snap_list(sizeof(int));
+    atomic_init(&done, 0);
+
+    printf("single threaded\n");
+    for(value = 0; value < 10; value++)
+        append_snap_list(lst, &value);
+
+    SnapShot snap;
+    take_snap_list(lst, &snap);
+    value = 100;
+    write_snap_list(lst, 0, &value);
+    delete_snap_list(lst, -1);
+
+    read_snapshot(&snap, 0, &value);
+    printf("snapshot: len: %d first: %d\n", length_snapshot(&snap), value);
+    release_snap_list(&snap);
+
+    take_snap_list(lst, &snap);
+    read_snapshot(&snap, 0, &value);
+    printf("current: len: %d first: %d\n\n", length_snapshot(&snap), value);
+    release_snap_list(&snap);
+
+    printf("start %d readers\n", NUM_READERS);
+    clear_snap_list(lst);
+    for(int i = 0; i < NUM_READERS; i++)
+        pthread_create(&threads[i], NULL, reader, NULL);
+
+    List* batch = create_list(sizeof(int));
+    for(int i = 0; i < NUM_WRITES; i++) {
+        if(i % 100 == 0) {
+            // publish a shorter version in one step
+            clear_list(batch);
+            for(value = 0; value < i % 7; value++)
+                append_list(batch, &value);
+            publish_snap_list(lst, batch);
+        }
+        else {
+            take_snap_list(lst, &snap);
+            value = length_snapshot(&snap);
+            release_snap_list(&snap);
+            append_snap_list(lst, &value);
+        }
+    }
+
+    atomic_store(&done, 1);
+    for(int i = 0; i < NUM_READERS; i++)
+        pthread_join(threads[i], NULL);
+
+    take_snap_list(lst, &snap);
+    printf("final length: %d\n", length_snapshot(&snap));
+    release_snap_list(&snap);
+
+    destroy_list(batch);
+    destroy_snap_list(lst);
+
+    return 0;
+}
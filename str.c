@@ -1,21 +1,152 @@
 #include <assert.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "util.h"
 
+// A Str always has a '\0' after the last character, so raw_string() does not
+// have to change anything. Every function that changes the length of the
+// string has to keep room for it and write it.
+static inline void terminate_string(Str* ptr) {
+
+    ptr->buffer[ptr->len] = '\0';
+}
+
+static inline bool is_small_string(Str* ptr) {
+
+    return ptr->buffer == ptr->small;
+}
+
+// Heap buffers have a reference count in front of the characters, so a
+// copy of a string can share the buffer with the original. The buffer is
+// copied the first time that one of them is changed. With USE_THREADS the
+// count is atomic, so strings that share a buffer can be used in different
+// threads.
+#ifdef USE_THREADS
+typedef atomic_int str_refs_t;
+
+static inline void ref_inc(str_refs_t* refs) {
+
+    atomic_fetch_add_explicit(refs, 1, memory_order_relaxed);
+}
+
+// Returns true when the last reference was dropped.
+static inline bool ref_dec(str_refs_t* refs) {
+
+    return atomic_fetch_sub_explicit(refs, 1, memory_order_acq_rel) == 1;
+}
+
+static inline int ref_count(str_refs_t* refs) {
+
+    return atomic_load_explicit(refs, memory_order_acquire);
+}
+#else
+typedef int str_refs_t;
+
+static inline void ref_inc(str_refs_t* refs) {
+
+    (*refs)++;
+}
+
+static inline bool ref_dec(str_refs_t* refs) {
+
+    return --(*refs) == 0;
+}
+
+static inline int ref_count(str_refs_t* refs) {
+
+    return *refs;
+}
+#endif
+
+typedef struct {
+    str_refs_t refs; // number of Str that use this buffer
+    char text[];     // the characters
+} StrBuf;
+
+static inline StrBuf* string_buf(Str* ptr) {
+
+    return (StrBuf*)(ptr->buffer - offsetof(StrBuf, text));
+}
+
+static char* alloc_buf(int cap) {
+
+    StrBuf* buf = _ALLOC(sizeof(StrBuf) + cap);
+#ifdef USE_THREADS
+    atomic_init(&buf->refs, 1);
+#else
+    buf->refs = 1;
+#endif
+
+    return buf->text;
+}
+
+static void release_buf(Str* ptr) {
+
+    if(!is_small_string(ptr)) {
+        StrBuf* buf = string_buf(ptr);
+        if(ref_dec(&buf->refs))
+            _FREE(buf);
+    }
+}
+
+static inline bool is_shared_string(Str* ptr) {
+
+    return !is_small_string(ptr) && ref_count(&string_buf(ptr)->refs) > 1;
+}
+
+// Make sure that there is room for len more characters and the terminator
+// and that the buffer is not shared, so it can be written. This is called
+// before every change, so it also forgets the hash. Short strings
+// live in the small buffer inside of the Str. When a string outgrows it,
+// it is moved to the heap and stays there.
+static void expand_string(Str* ptr, int len) {
+
+    int need = ptr->len + len + 1;
+    bool shared = is_shared_string(ptr);
+
+    ptr->hash = 0;
+
+    if(need > ptr->cap || shared) {
+        int cap = ptr->cap;
+        while(need > cap)
+            cap <<= 1;
+
+        if(is_small_string(ptr) || shared) {
+            char* buf = alloc_buf(cap);
+            memcpy(buf, ptr->buffer, ptr->len + 1);
+            release_buf(ptr);
+            ptr->buffer = buf;
+        }
+        else {
+            StrBuf* buf = _REALLOC(string_buf(ptr), sizeof(StrBuf) + cap);
+            ptr->buffer = buf->text;
+        }
+        ptr->cap = cap;
+    }
+}
+
+// Called before the characters are changed in place.
+static inline void own_string(Str* ptr) {
+
+    expand_string(ptr, 0);
+}
+
 // Join a list where the str is between the elements of the list.
-Str* join_str_list(StrList* lst, const char* str) {
+Str* join_string_list(StrList* lst, const char* str) {
 
     Str* s = create_string(NULL);
     Str* tmp;
 
     StrListIter* sli = init_string_list_iterator(lst);
-    add_string_Str(s, iterate_string_list(sli));
-    while(NULL != (tmp = iterate_string_list(sli))) {
-        add_string_str(s, str);
+    if(NULL != (tmp = iterate_string_list(sli))) {
         add_string_Str(s, tmp);
+        while(NULL != (tmp = iterate_string_list(sli))) {
+            add_string_str(s, str);
+            add_string_Str(s, tmp);
+        }
     }
 
     return s;
@@ -23,7 +154,12 @@ Str* join_str_list(StrList* lst, const char* str) {
 
 Str* create_string(const char* str) {
 
-    Str* ptr = create_list(sizeof(char));
+    Str* ptr = _ALLOC_T(Str);
+    ptr->buffer = ptr->small;
+    ptr->cap = STR_SMALL_SIZE;
+    ptr->len = 0;
+    ptr->hash = 0;
+    terminate_string(ptr);
 
     if(str != NULL)
         add_string_str(ptr, str);
@@ -36,39 +172,74 @@ Str* create_string_fmt(const char* str, ...) {
     assert(str != NULL);
     va_list args;
 
-    va_start(args, str);
-    size_t len = vsnprintf(NULL, 0, str, args);
-    va_end(args);
-
-    char* ptr = _ALLOC(len + 1);
+    Str* retv = create_string(NULL);
 
     va_start(args, str);
-    vsnprintf(ptr, len + 1, str, args);
+    add_string_vfmt(retv, str, args);
     va_end(args);
 
-    Str* retv = create_string(ptr);
-    _FREE(ptr);
-
     return retv;
 }
 
 void destroy_string(Str* ptr) {
 
     if(ptr != NULL) {
-        destroy_list(ptr);
+        release_buf(ptr);
         _FREE(ptr);
     }
 }
 
+// Make room for len more characters, so a series of adds does not have to
+// grow the buffer one step at a time.
+void reserve_string(Str* ptr, int len) {
+
+    expand_string(ptr, len);
+}
+
 void add_string_char(Str* ptr, int ch) {
 
-    append_list(ptr, &ch);
+    expand_string(ptr, 1);
+    ptr->buffer[ptr->len++] = (char)ch;
+    terminate_string(ptr);
+}
+
+// Add len bytes from the buffer with a single copy.
+void add_string_bytes(Str* ptr, const void* buf, int len) {
+
+    expand_string(ptr, len);
+    memcpy(&ptr->buffer[ptr->len], buf, len);
+    ptr->len += len;
+    terminate_string(ptr);
 }
 
 void add_string_str(Str* ptr, const char* str) {
 
-    for(const char* ch = str; *ch != '\0'; ch++)
-        add_string_char(ptr, *ch);
+    add_string_bytes(ptr, str, strlen(str));
+}
+
+// Format directly into the end of the string. The first pass uses the room
+// that is already there and the second pass is only needed if that was not
+// enough.
+void add_string_vfmt(Str* ptr, const char* str, va_list args) {
+
+    assert(ptr != NULL);
+    assert(str != NULL);
+
+    va_list copy;
+    va_copy(copy, args);
+
+    own_string(ptr);
+    int room = ptr->cap - ptr->len;
+    int len = vsnprintf(&ptr->buffer[ptr->len], room, str, args);
+
+    if(len >= room) {
+        expand_string(ptr, len);
+        vsnprintf(&ptr->buffer[ptr->len], len + 1, str, copy);
+    }
+    va_end(copy);
+
+    if(len > 0)
+        ptr->len += len;
 }
 
 void add_string_fmt(Str* ptr, const char* str, ...) {
@@ -79,77 +250,128 @@ void add_string_fmt(Str* ptr, const char* str, ...) {
     va_list args;
 
     va_start(args, str);
-    size_t len = vsnprintf(NULL, 0, str, args);
+    add_string_vfmt(ptr, str, args);
     va_end(args);
+}
 
-    char* spt = _ALLOC(len + 1);
+StrIter* init_string_iterator(Str* ptr) {
 
-    va_start(args, str);
-    vsnprintf(spt, len + 1, str, args);
-    va_end(args);
-
-    add_string_str(ptr, spt);
-    _FREE(spt);
-}
+    StrIter* iter = _ALLOC_T(StrIter);
+    iter->str = ptr;
+    iter->index = 0;
 
-StrIter* init_string_iter(Str* ptr) {
-    return init_list_iterator(ptr);
+    return iter;
 }
 
+// Returns 0 at the end of the string.
 int iterate_string(StrIter* ptr) {
-    int ch;
-    if(iterate_list(ptr, &ch))
-        return ch;
+
+    if(ptr->index < ptr->str->len)
+        return (unsigned char)ptr->str->buffer[ptr->index++];
     else
         return 0;
 }
 
 const char* raw_string(Str* ptr) {
 
-    int ch = 0;
-    push_list(ptr, &ch);
-    pop_list(ptr, NULL);
+    return ptr->buffer;
+}
+
+// Same rules as strcmp(), but the lengths are known, so the bytes are
+// compared with memcmp().
+static inline int comp_bytes(const char* s1, int len1, const char* s2, int len2) {
+
+    int val = memcmp(s1, s2, (len1 < len2) ? len1 : len2);
 
-    return (const char*)raw_list(ptr);
+    if(val != 0)
+        return val;
+    else
+        return (len1 > len2) - (len1 < len2);
 }
 
 int comp_string(Str* s1, Str* s2) {
-    return strcmp(raw_string(s1), raw_string(s2));
+    return comp_bytes(raw_string(s1), s1->len, raw_string(s2), s2->len);
 }
 
 int comp_string_const(Str* s1, const char* s2) {
-    return strcmp(raw_string(s1), s2);
+    return comp_bytes(raw_string(s1), s1->len, s2, strlen(s2));
 }
 
+// A copy of a string on the heap shares the buffer with the original, so
+// this does not copy the characters. A short string is copied.
 Str* copy_string(Str* str) {
-    return create_string(raw_string(str));
+
+    if(is_small_string(str)) {
+        Str* ptr = create_string(NULL);
+        add_string_bytes(ptr, raw_string(str), length_string(str));
+        return ptr;
+    }
+
+    Str* ptr = _ALLOC_T(Str);
+    ptr->buffer = str->buffer;
+    ptr->len = str->len;
+    ptr->cap = str->cap;
+    ptr->hash = str->hash;
+    ref_inc(&string_buf(str)->refs);
+
+    return ptr;
 }
 
+// Cut the string off at the index. A negative index counts from the end.
 void truncate_string(Str* str, int index) {
 
-    int val = 0;
-    write_list(str, index, &val);
+    if(index < 0)
+        index = str->len + index + 1;
+
+    if(index < 0 || index > str->len)
+        RAISE(LIST_ERROR, "List Error: index out of range: %d\n", index);
+
+    own_string(str);
+    str->len = index;
+    terminate_string(str);
 }
 
 void clear_string(Str* str) {
 
-    truncate_string(str, 0);
-    clear_list(str);
+    // a shared buffer is let go instead of copied
+    if(is_shared_string(str)) {
+        release_buf(str);
+        str->buffer = str->small;
+        str->cap = STR_SMALL_SIZE;
+    }
+
+    str->len = 0;
+    str->hash = 0;
+    terminate_string(str);
 }
 
 int length_string(Str* str) {
 
-    return length_list(str);
+    return str->len;
+}
+
+// Return hash_bytes() of the string. The hash is kept in the Str until the
+// string is changed, so using the same Str as a key many times only hashes
+// it once. A hash of 0 is not kept, but it does not happen often.
+uint32_t hash_string(Str* str) {
+
+    if(str->hash == 0)
+        str->hash = hash_bytes(str->buffer, str->len);
+
+    return str->hash;
 }
 
 void add_string_Str(Str* ptr, Str* str) {
 
-    add_string_str(ptr, raw_string(str));
+    // reserve first, in case the string is added to itself
+    int len = length_string(str);
+    expand_string(ptr, len);
+    add_string_bytes(ptr, str->buffer, len);
 }
 
 void print_string(FILE* fp, Str* str) {
 
-    fprintf(fp, "%s", raw_string(str));
+    fwrite(raw_string(str), 1, length_string(str), fp);
 }
 
 void printf_string(FILE* fp, Str* str, ...) {
@@ -161,32 +383,192 @@ void printf_string(FILE* fp, Str* str, ...) {
     va_end(args);
 }
 
-Str* upcase_string(Str* str) {
+// ASCII case conversion. Only the letters A-Z and a-z are changed, so
+// this does not depend on the locale and bytes of UTF-8 sequences are
+// left alone. The SSE2 kernel does 16 bytes at a time, otherwise 8 bytes
+// are done at a time in a 64 bit word. In both, a letter is found by
+// checking that the byte is in the range, and the case bit (0x20) is set
+// or cleared for the letters.
+#define CASE_BIT 0x20
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+static int case_block(char* dst, const char* src, int len, bool upper) {
+
+    // signed compare, so bytes with the high bit set are never in range
+    __m128i lo = _mm_set1_epi8(upper ? 'a' - 1 : 'A' - 1);
+    __m128i hi = _mm_set1_epi8(upper ? 'z' + 1 : 'Z' + 1);
+    __m128i bit = _mm_set1_epi8(CASE_BIT);
+    int i = 0;
+
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)&src[i]);
+        __m128i in = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+        _mm_storeu_si128((__m128i*)&dst[i], _mm_xor_si128(v, _mm_and_si128(in, bit)));
+    }
 
-    char* ptr = _DUP_STR(raw_string(str));
+    return i;
+}
+#else
+static int case_block(char* dst, const char* src, int len, bool upper) {
+
+    const uint64_t ones = 0x0101010101010101ull;
+    const uint64_t high = 0x8080808080808080ull;
+    uint64_t first = 0x80 - (upper ? 'a' : 'A');
+    uint64_t last = 0x80 - (upper ? 'z' : 'Z') - 1;
+    int i = 0;
+
+    for(; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, &src[i], 8);
+        // the high bit of every byte in the range is set in mask. Bytes with
+        // the high bit already set are removed with ~w.
+        uint64_t low = w & ~high;
+        uint64_t mask = ((low + first * ones) & ~(low + last * ones) & ~w) & high;
+        w ^= mask >> 2;
+        memcpy(&dst[i], &w, 8);
+    }
+
+    return i;
+}
+#endif
 
-    while(*ptr != '\0') {
-        *ptr = toupper(*ptr);
-        ptr++;
+static void convert_case(char* dst, const char* src, int len, bool upper) {
+
+    int i = case_block(dst, src, len, upper);
+    int first = upper ? 'a' : 'A';
+    int last = upper ? 'z' : 'Z';
+
+    for(; i < len; i++) {
+        int ch = (unsigned char)src[i];
+        dst[i] = (ch >= first && ch <= last) ? ch ^ CASE_BIT : ch;
     }
+}
+
+static Str* copy_case(Str* str, bool upper) {
 
-    Str* s = create_string(ptr);
-    _FREE(ptr);
+    Str* s = create_string(NULL);
+    expand_string(s, str->len);
+    convert_case(s->buffer, str->buffer, str->len, upper);
+    s->len = str->len;
+    terminate_string(s);
 
     return s;
 }
 
+// Return a new string with the letters converted.
+Str* upcase_string(Str* str) {
+
+    return copy_case(str, true);
+}
+
 Str* downcase_string(Str* str) {
 
-    char* ptr = _DUP_STR(raw_string(str));
+    return copy_case(str, false);
+}
+
+// Convert the letters in place.
+void upcase_string_inplace(Str* str) {
+
+    own_string(str);
+    convert_case(str->buffer, str->buffer, str->len, true);
+}
 
-    while(*ptr != '\0') {
-        *ptr = tolower(*ptr);
-        ptr++;
+void downcase_string_inplace(Str* str) {
+
+    own_string(str);
+    convert_case(str->buffer, str->buffer, str->len, false);
+}
+
+// Same rules as strcasecmp(), without the locale.
+int comp_string_nocase(Str* s1, Str* s2) {
+
+    return comp_view_nocase(view_Str(s1), view_Str(s2));
+}
+
+int comp_string_const_nocase(Str* s1, const char* s2) {
+
+    return comp_view_nocase(view_Str(s1), view_str(s2));
+}
+
+// Searching. These return the index of the match or -1. The work is done
+// on views in strview.c.
+int find_string(Str* str, const char* needle) {
+
+    return find_view(view_Str(str), view_str(needle));
+}
+
+int rfind_string(Str* str, const char* needle) {
+
+    return rfind_view(view_Str(str), view_str(needle));
+}
+
+// Find the first character that is in set.
+int find_any_string(Str* str, const char* set) {
+
+    return find_any_view(view_Str(str), view_str(set));
+}
+
+int count_string(Str* str, const char* needle) {
+
+    return count_view(view_Str(str), view_str(needle));
+}
+
+// Return a new string where every old is replaced with new. The matches are
+// counted first so that the result is allocated once at the final size and
+// written in one pass.
+Str* replace_string(Str* str, const char* old, const char* new) {
+
+    StrView rest = view_Str(str);
+    StrView from = view_str(old);
+    StrView to = view_str(new);
+    Str* s = create_string(NULL);
+
+    int count = count_view(rest, from);
+    if(count == 0) {
+        add_string_view(s, rest);
+        return s;
     }
 
-    Str* s = create_string(ptr);
-    _FREE(ptr);
+    expand_string(s, rest.len + count * (to.len - from.len));
+
+    int idx;
+    while((idx = find_view(rest, from)) >= 0) {
+        memcpy(&s->buffer[s->len], rest.ptr, idx);
+        memcpy(&s->buffer[s->len + idx], to.ptr, to.len);
+        s->len += idx + to.len;
+        rest = sub_view(rest, idx + from.len, -1);
+    }
+    memcpy(&s->buffer[s->len], rest.ptr, rest.len);
+    s->len += rest.len;
+    terminate_string(s);
 
     return s;
 }
+
+// Split the string on sep and return a list of new strings. Empty fields
+// are kept. An empty string gives an empty list.
+StrList* split_string(Str* str, const char* sep) {
+
+    StrList* lst = create_string_list();
+    StrView rest = view_Str(str);
+    StrView delim = view_str(sep);
+
+    if(rest.len == 0)
+        return lst;
+
+    if(delim.len == 0) {
+        add_string_list(lst, copy_string(str));
+        return lst;
+    }
+
+    int idx;
+    while((idx = find_view(rest, delim)) >= 0) {
+        add_string_list(lst, create_string_view(sub_view(rest, 0, idx)));
+        rest = sub_view(rest, idx + delim.len, -1);
+    }
+    add_string_list(lst, create_string_view(rest));
+
+    return lst;
+}
@@ -9,14 +9,108 @@ int main() {
     add_string_str(s, " plus this one");
     printf("%s\n", raw_string(s));
 
-    StrList* lst = create_str_list();
-    add_str_list(lst, s);
+    StrList* lst = create_string_list();
+    add_string_list(lst, s);
 
-    StrListIter* itr = init_str_list_iter(lst);
+    StrListIter* itr = init_string_list_iterator(lst);
     Str* tpt;
-    while(NULL != (tpt = iterate_str_list(itr)))
+    while(NULL != (tpt = iterate_string_list(itr)))
         printf("lst: %s\n", raw_string(tpt));
 
+    printf("\nbuilder\n");
+    Str* b = create_string_fmt("%s-%d", "fmt", 42);
+    reserve_string(b, 100);
+    add_string_bytes(b, "[bytes]xxx", 7);
+    add_string_fmt(b, " %05d %s", 7, "a long formatted string that does not fit in the room");
+    add_string_Str(b, b);
+    printf("%s (%d)\n", raw_string(b), length_string(b));
+
+    printf("\ntruncate and compare\n");
+    truncate_string(b, 6);
+    printf("%s (%d)\n", raw_string(b), length_string(b));
+    Str* c = copy_string(b);
+    printf("equal: %d\n", comp_string(b, c));
+    add_string_char(c, '!');
+    printf("shorter: %d longer: %d\n", comp_string(b, c), comp_string(c, b));
+    printf("const: %d %d\n", comp_string_const(b, "fmt-42"), comp_string_const(b, "fmt-4"));
+    clear_string(c);
+    printf("cleared: \"%s\" (%d)\n", raw_string(c), length_string(c));
+
+    printf("\ngrow a short string onto the heap\n");
+    Str* d = create_string("short");
+    printf("%s (%d)\n", raw_string(d), length_string(d));
+    for(int i = 0; i < 4; i++)
+        add_string_str(d, " and longer");
+    printf("%s (%d)\n", raw_string(d), length_string(d));
+
+    printf("\niterate and join\n");
+    StrIter* si = init_string_iterator(c);
+    add_string_str(c, "abc");
+    int ch;
+    while(0 != (ch = iterate_string(si)))
+        printf("%c ", ch);
+    printf("\n");
+    StrList* words = create_string_list();
+    add_string_list(words, create_string("one"));
+    add_string_list(words, create_string("two"));
+    add_string_list(words, create_string("three"));
+    Str* j = join_string_list(words, ", ");
+    printf("%s\n", raw_string(j));
+
+    printf("\ncase conversion\n");
+    Str* m = create_string("Mixed Case: 123 [ABC_xyz] @`{} \xc3\xa9 and a Longer Tail Part");
+    Str* up = upcase_string(m);
+    Str* down = downcase_string(m);
+    printf("%s\n%s\n", raw_string(up), raw_string(down));
+    upcase_string_inplace(m);
+    printf("inplace: %d\n", comp_string(m, up));
+    downcase_string_inplace(m);
+    printf("inplace: %d\n", comp_string(m, down));
+    printf("nocase: %d %d\n", comp_string_nocase(up, down), comp_string_const_nocase(up, "MIXED"));
+    printf("nocase order: %d %d\n", comp_string_const_nocase(b, "FMT-5") < 0,
+           comp_string_const_nocase(b, "FMT-") > 0);
+    printf("nocase hash: %d\n", hash_bytes_nocase(raw_string(up), length_string(up)) ==
+                                      hash_bytes(raw_string(down), length_string(down)));
+
+    printf("\nsearch and replace\n");
+    Str* t = create_string("the {name} of the {name} is {value}, longer than sixteen bytes {name}");
+    printf("find: %d rfind: %d missing: %d\n", find_string(t, "{name}"), rfind_string(t, "{name}"),
+           find_string(t, "{nope}"));
+    printf("find any: %d count: %d\n", find_any_string(t, "{},"), count_string(t, "{name}"));
+    Str* r = replace_string(t, "{name}", "NAME");
+    printf("%s (%d)\n", raw_string(r), length_string(r));
+    Str* r2 = replace_string(r, "NAME", "a much longer name");
+    printf("%s (%d)\n", raw_string(r2), length_string(r2));
+    StrList* parts = split_string(t, " {");
+    StrListIter* pi = init_string_list_iterator(parts);
+    while(NULL != (tpt = iterate_string_list(pi)))
+        printf("part: \"%s\"\n", raw_string(tpt));
+
+    printf("\nshared copies\n");
+    Str* orig = create_string("a string that is too long to be stored in the Str");
+    Str* c1 = copy_string(orig);
+    Str* c2 = copy_string(c1);
+    printf("shared: %d %d\n", raw_string(orig) == raw_string(c1), raw_string(c1) == raw_string(c2));
+    add_string_str(c1, " (changed)");
+    upcase_string_inplace(c2);
+    printf("orig: %s\nc1: %s\nc2: %s\n", raw_string(orig), raw_string(c1), raw_string(c2));
+    Str* c3 = copy_string(orig);
+    truncate_string(c3, 8);
+    clear_string(orig);
+    printf("c3: \"%s\" orig: \"%s\"\n", raw_string(c3), raw_string(orig));
+    destroy_string(orig);
+    destroy_string(c1);
+    destroy_string(c2);
+    destroy_string(c3);
+
+    destroy_string(d);
+    destroy_string(j);
+    destroy_string(t);
+    destroy_string(r);
+    destroy_string(r2);
+    destroy_string(m);
+    destroy_string(up);
+    destroy_string(down);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,349 @@
+/*
+ * String views. A StrView is a pointer and a length that refers to
+ * characters owned by something else, such as a Str, a const char* or a
+ * line buffer. Views are passed by value and nothing in this file
+ * allocates, except for the conversions back to a Str. A view is not
+ * '\0' terminated, so print it with "%.*s", v.len, v.ptr.
+ *
+ * A view is only good as long as the characters it refers to are not
+ * changed or freed.
+ */
+#include "util.h"
+
+static inline bool is_space(int ch) {
+
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+StrView view_bytes(const char* ptr, int len) {
+
+    StrView v = { ptr, len };
+    return v;
+}
+
+StrView view_str(const char* str) {
+
+    return view_bytes(str, strlen(str));
+}
+
+StrView view_Str(Str* str) {
+
+    return view_bytes(raw_string(str), length_string(str));
+}
+
+// Return the part of the view that starts at start and is len long. The
+// result is clipped to the view. A negative len means the rest of the view.
+StrView sub_view(StrView v, int start, int len) {
+
+    if(start < 0)
+        start = 0;
+    if(start > v.len)
+        start = v.len;
+    if(len < 0 || start + len > v.len)
+        len = v.len - start;
+
+    return view_bytes(v.ptr + start, len);
+}
+
+StrView ltrim_view(StrView v) {
+
+    int i = 0;
+    while(i < v.len && is_space((unsigned char)v.ptr[i]))
+        i++;
+
+    return view_bytes(v.ptr + i, v.len - i);
+}
+
+StrView rtrim_view(StrView v) {
+
+    int len = v.len;
+    while(len > 0 && is_space((unsigned char)v.ptr[len - 1]))
+        len--;
+
+    return view_bytes(v.ptr, len);
+}
+
+StrView trim_view(StrView v) {
+
+    return rtrim_view(ltrim_view(v));
+}
+
+// Return the index of the first ch in the view or -1 if it is not there.
+int find_char_view(StrView v, int ch) {
+
+    const char* ptr = memchr(v.ptr, ch, v.len);
+
+    return (ptr != NULL) ? (int)(ptr - v.ptr) : -1;
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+// Look for the needle 16 positions at a time. A position is only checked
+// with memcmp() when both the first and the last characters of the needle
+// match, which rules out almost all of them. Returns the index or -1 and
+// sets next to the first position that was not looked at.
+static int find_block(StrView v, StrView needle, int* next) {
+
+    __m128i first = _mm_set1_epi8(needle.ptr[0]);
+    __m128i last = _mm_set1_epi8(needle.ptr[needle.len - 1]);
+    int i = 0;
+
+    for(; i + 16 + needle.len - 1 <= v.len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)&v.ptr[i]);
+        __m128i b = _mm_loadu_si128((const __m128i*)&v.ptr[i + needle.len - 1]);
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                                        _mm_cmpeq_epi8(b, last)));
+        while(mask != 0) {
+            int pos = i + __builtin_ctz(mask);
+            if(memcmp(&v.ptr[pos], needle.ptr, needle.len) == 0)
+                return pos;
+            mask &= mask - 1;
+        }
+    }
+
+    *next = i;
+    return -1;
+}
+#endif
+
+// Return the index of the first place where needle is found or -1.
+int find_view(StrView v, StrView needle) {
+
+    if(needle.len == 0)
+        return 0;
+    if(needle.len > v.len)
+        return -1;
+
+    const char* ptr = v.ptr;
+    const char* end = v.ptr + v.len - needle.len + 1;
+
+#ifdef __SSE2__
+    int next;
+    int idx = find_block(v, needle, &next);
+    if(idx >= 0)
+        return idx;
+    ptr += next;
+#endif
+
+    while(ptr < end) {
+        ptr = memchr(ptr, needle.ptr[0], end - ptr);
+        if(ptr == NULL)
+            break;
+        if(memcmp(ptr, needle.ptr, needle.len) == 0)
+            return (int)(ptr - v.ptr);
+        ptr++;
+    }
+
+    return -1;
+}
+
+// Return the index of the last place where needle is found or -1.
+int rfind_view(StrView v, StrView needle) {
+
+    if(needle.len > v.len)
+        return -1;
+    if(needle.len == 0)
+        return v.len;
+
+    for(int i = v.len - needle.len; i >= 0; i--) {
+        if(v.ptr[i] == needle.ptr[0] && memcmp(&v.ptr[i], needle.ptr, needle.len) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+// Return the index of the first character in v that is also in set, or -1.
+// Sets of up to 4 characters are checked 16 bytes at a time. Larger sets
+// use a table with a bit for every character.
+int find_any_view(StrView v, StrView set) {
+
+    if(set.len == 0)
+        return -1;
+    if(set.len == 1)
+        return find_char_view(v, (unsigned char)set.ptr[0]);
+
+    int i = 0;
+
+#ifdef __SSE2__
+    if(set.len <= 4) {
+        __m128i c[4];
+        for(int k = 0; k < 4; k++)
+            c[k] = _mm_set1_epi8(set.ptr[(k < set.len) ? k : set.len - 1]);
+
+        for(; i + 16 <= v.len; i += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i*)&v.ptr[i]);
+            __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(a, c[0]), _mm_cmpeq_epi8(a, c[1])),
+                                     _mm_or_si128(_mm_cmpeq_epi8(a, c[2]), _mm_cmpeq_epi8(a, c[3])));
+            unsigned mask = _mm_movemask_epi8(m);
+            if(mask != 0)
+                return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    uint64_t bits[4] = { 0, 0, 0, 0 };
+    for(int k = 0; k < set.len; k++) {
+        unsigned char ch = set.ptr[k];
+        bits[ch >> 6] |= 1ull << (ch & 63);
+    }
+
+    for(; i < v.len; i++) {
+        unsigned char ch = v.ptr[i];
+        if(bits[ch >> 6] & (1ull << (ch & 63)))
+            return i;
+    }
+
+    return -1;
+}
+
+// Return the number of times that needle is in v. Matches do not overlap.
+int count_view(StrView v, StrView needle) {
+
+    int count = 0;
+    int idx;
+
+    if(needle.len == 0)
+        return 0;
+
+    while((idx = find_view(v, needle)) >= 0) {
+        count++;
+        v = sub_view(v, idx + needle.len, -1);
+    }
+
+    return count;
+}
+
+// Same rules as strcmp().
+int comp_view(StrView s1, StrView s2) {
+
+    int val = memcmp(s1.ptr, s2.ptr, (s1.len < s2.len) ? s1.len : s2.len);
+
+    if(val != 0)
+        return val;
+    else
+        return (s1.len > s2.len) - (s1.len < s2.len);
+}
+
+bool equal_view(StrView s1, StrView s2) {
+
+    return s1.len == s2.len && memcmp(s1.ptr, s2.ptr, s1.len) == 0;
+}
+
+static inline int lower_char(int ch) {
+
+    return (ch >= 'A' && ch <= 'Z') ? ch | 0x20 : ch;
+}
+
+// Lower case the ASCII letters in 8 bytes at once. See convert_case() in
+// str.c for how this works.
+static inline uint64_t lower_word(uint64_t w) {
+
+    const uint64_t ones = 0x0101010101010101ull;
+    const uint64_t high = 0x8080808080808080ull;
+    uint64_t low = w & ~high;
+    uint64_t mask = ((low + (0x80 - 'A') * ones) & ~(low + (0x80 - 'Z' - 1) * ones) & ~w) & high;
+
+    return w | (mask >> 2);
+}
+
+// Same rules as strcasecmp(), but only ASCII letters are folded and the
+// locale is not used. Nothing is copied. Equal runs are skipped 8 bytes at
+// a time.
+int comp_view_nocase(StrView s1, StrView s2) {
+
+    int len = (s1.len < s2.len) ? s1.len : s2.len;
+    int i = 0;
+
+    for(; i + 8 <= len; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, &s1.ptr[i], 8);
+        memcpy(&b, &s2.ptr[i], 8);
+        if(a != b && lower_word(a) != lower_word(b))
+            break;
+    }
+
+    for(; i < len; i++) {
+        int a = lower_char((unsigned char)s1.ptr[i]);
+        int b = lower_char((unsigned char)s2.ptr[i]);
+        if(a != b)
+            return a - b;
+    }
+
+    return (s1.len > s2.len) - (s1.len < s2.len);
+}
+
+bool equal_view_nocase(StrView s1, StrView s2) {
+
+    return s1.len == s2.len && comp_view_nocase(s1, s2) == 0;
+}
+
+bool starts_with_view(StrView v, StrView prefix) {
+
+    return v.len >= prefix.len && memcmp(v.ptr, prefix.ptr, prefix.len) == 0;
+}
+
+bool ends_with_view(StrView v, StrView suffix) {
+
+    return v.len >= suffix.len &&
+           memcmp(v.ptr + v.len - suffix.len, suffix.ptr, suffix.len) == 0;
+}
+
+// Take the next field from the front of rest. The field ends at the next
+// sep or at the end of rest and the separator is skipped. Returns false
+// when there are no more fields.
+bool next_view(StrView* rest, int sep, StrView* field) {
+
+    if(rest->ptr == NULL)
+        return false;
+
+    int idx = find_char_view(*rest, sep);
+    if(idx < 0) {
+        *field = *rest;
+        rest->ptr = NULL; // finished
+        rest->len = 0;
+    }
+    else {
+        *field = view_bytes(rest->ptr, idx);
+        rest->ptr += idx + 1;
+        rest->len -= idx + 1;
+    }
+
+    return true;
+}
+
+// Split the view on sep and append the fields to out, which is a List of
+// StrView. Returns the number of fields that were added. An empty view has
+// no fields. The List can be cleared and used again so that splitting many
+// lines does not allocate.
+int split_view(StrView v, int sep, List* out) {
+
+    StrView field;
+    int count = 0;
+
+    assert(out->size == sizeof(StrView));
+
+    if(v.len == 0)
+        return 0;
+
+    while(next_view(&v, sep, &field)) {
+        append_list(out, &field);
+        count++;
+    }
+
+    return count;
+}
+
+Str* create_string_view(StrView v) {
+
+    Str* ptr = create_string(NULL);
+    add_string_bytes(ptr, v.ptr, v.len);
+
+    return ptr;
+}
+
+void add_string_view(Str* ptr, StrView v) {
+
+    add_string_bytes(ptr, v.ptr, v.len);
+}
@@ -0,0 +1,64 @@
+
+#include "util.h"
+
+void show(const char* label, StrView v) {
+
+    printf("%s: \"%.*s\" (%d)\n", label, v.len, v.ptr, v.len);
+}
+
+int main() {
+
+    StrView line = view_str("   name = value, other = 42 ,last=  \n");
+
+    printf("trim and sub views\n");
+    show("line", line);
+    show("trim", trim_view(line));
+    show("ltrim", ltrim_view(line));
+    show("rtrim", rtrim_view(line));
+    show("sub", sub_view(trim_view(line), 7, 5));
+    show("sub past end", sub_view(trim_view(line), 30, 100));
+
+    printf("\nfind and compare\n");
+    StrView t = trim_view(line);
+    printf("find '=': %d\n", find_char_view(t, '='));
+    printf("find \"other\": %d\n", find_view(t, view_str("other")));
+    printf("find \"missing\": %d\n", find_view(t, view_str("missing")));
+    printf("starts with \"name\": %d\n", starts_with_view(t, view_str("name")));
+    printf("ends with \"last=\": %d\n", ends_with_view(t, view_str("last=")));
+    printf("comp: %d %d %d\n", comp_view(view_str("abc"), view_str("abd")),
+           comp_view(view_str("abc"), view_str("abc")), comp_view(view_str("abcd"), view_str("abc")));
+
+    printf("\nsplit into fields without allocating per field\n");
+    List* fields = create_list(sizeof(StrView));
+    int n = split_view(t, ',', fields);
+    StrView* f = raw_list(fields);
+    for(int i = 0; i < n; i++) {
+        StrView key, val, rest = trim_view(f[i]);
+        next_view(&rest, '=', &key);
+        next_view(&rest, '=', &val);
+        printf("%d. key: \"%.*s\" val: \"%.*s\"\n", i, trim_view(key).len, trim_view(key).ptr,
+               trim_view(val).len, trim_view(val).ptr);
+    }
+
+    printf("\nviews as hash keys\n");
+    HashTable* tab = create_hashtable();
+    for(int i = 0; i < n; i++) {
+        StrView rest = trim_view(f[i]), key;
+        next_view(&rest, '=', &key);
+        insert_hashtable_view(tab, trim_view(key), &i, sizeof(i));
+    }
+    int idx = -1;
+    printf("other: %s ", (find_hashtable_view(tab, view_str("other"), &idx, sizeof(idx)) == HASH_OK) ? "found" : "not found");
+    printf("%d\n", idx);
+    StrView oth = sub_view(view_str("other"), 0, 3);
+    printf("oth: %s\n", (find_hashtable_view(tab, oth, &idx, sizeof(idx)) == HASH_OK) ? "found" : "not found");
+    printf("name: %s\n", (find_hashtable(tab, "name", &idx, sizeof(idx)) == HASH_OK) ? "found" : "not found");
+
+    printf("\nback to Str\n");
+    Str* s = create_string_view(f[0]);
+    add_string_view(s, view_str("|"));
+    add_string_view(s, f[1]);
+    printf("\"%s\"\n", raw_string(s));
+
+    return 0;
+}
@@ -0,0 +1,261 @@
+/*
+ * UTF-8 text. A Str is a string of bytes and these functions look at the
+ * bytes as UTF-8: check that they are valid, count the code points and
+ * return the code points one at a time.
+ *
+ * Most source text is all ASCII, so the bytes are looked at 16 at a time
+ * with SSE2 (8 at a time in a 64 bit word otherwise) and a block with no
+ * high bits set is skipped without decoding it. Counting code points is
+ * the number of bytes that are not continuation bytes (10xxxxxx), which
+ * is done on whole blocks as well.
+ */
+#include "util.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+// Return the number of bytes at the front of buf that are in whole ASCII
+// blocks.
+static int ascii_block(const unsigned char* buf, int len) {
+
+    int i = 0;
+
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)&buf[i]);
+        if(_mm_movemask_epi8(v) != 0)
+            break;
+    }
+
+    return i;
+}
+
+// Return the number of bytes that are not continuation bytes in the whole
+// blocks at the front of buf and set done to the number of bytes that were
+// looked at.
+static int count_block(const unsigned char* buf, int len, int* done) {
+
+    // continuation bytes are -128 to -65 as signed bytes
+    __m128i cont = _mm_set1_epi8((char)0xBF);
+    int count = 0;
+    int i = 0;
+
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)&buf[i]);
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(v, cont)));
+    }
+
+    *done = i;
+    return count;
+}
+#else
+#define HIGH_BITS 0x8080808080808080ull
+
+static int ascii_block(const unsigned char* buf, int len) {
+
+    int i = 0;
+
+    for(; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, &buf[i], 8);
+        if(w & HIGH_BITS)
+            break;
+    }
+
+    return i;
+}
+
+static int count_block(const unsigned char* buf, int len, int* done) {
+
+    int count = 0;
+    int i = 0;
+
+    for(; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, &buf[i], 8);
+        // the high bit of a byte is set if the byte is 10xxxxxx
+        uint64_t cont = w & ~(w << 1) & HIGH_BITS;
+        count += 8 - __builtin_popcountll(cont);
+    }
+
+    *done = i;
+    return count;
+}
+#endif
+
+// Decode one code point. Returns the number of bytes that it used, or 0 if
+// the bytes are not valid UTF-8 or the sequence is cut off by the end of
+// the buffer. Overlong forms, surrogates and values past U+10FFFF are not
+// valid.
+static int decode_utf8(const unsigned char* buf, int len, int* cp) {
+
+    int ch = buf[0];
+    int need, min;
+
+    if(ch < 0x80) {
+        *cp = ch;
+        return 1;
+    }
+    else if(ch < 0xC2)
+        return 0;
+    else if(ch < 0xE0) {
+        need = 2;
+        min = 0x80;
+        ch &= 0x1F;
+    }
+    else if(ch < 0xF0) {
+        need = 3;
+        min = 0x800;
+        ch &= 0x0F;
+    }
+    else if(ch < 0xF5) {
+        need = 4;
+        min = 0x10000;
+        ch &= 0x07;
+    }
+    else
+        return 0;
+
+    if(len < need)
+        return 0;
+
+    for(int i = 1; i < need; i++) {
+        if((buf[i] & 0xC0) != 0x80)
+            return 0;
+        ch = (ch << 6) | (buf[i] & 0x3F);
+    }
+
+    if(ch < min || ch > 0x10FFFF || (ch >= 0xD800 && ch <= 0xDFFF))
+        return 0;
+
+    *cp = ch;
+    return need;
+}
+
+// Return the number of bytes that a sequence that starts with the byte
+// should have, or 0 if it cannot start a sequence.
+int length_utf8_char(int ch) {
+
+    ch &= 0xFF;
+    if(ch < 0x80)
+        return 1;
+    else if(ch < 0xC2)
+        return 0;
+    else if(ch < 0xE0)
+        return 2;
+    else if(ch < 0xF0)
+        return 3;
+    else if(ch < 0xF5)
+        return 4;
+    else
+        return 0;
+}
+
+// True if there are no bytes with the high bit set. Text that is all ASCII
+// does not need to be decoded at all.
+bool is_ascii_view(StrView v) {
+
+    const unsigned char* buf = (const unsigned char*)v.ptr;
+    int i = ascii_block(buf, v.len);
+
+    for(; i < v.len; i++) {
+        if(buf[i] & 0x80)
+            return false;
+    }
+
+    return true;
+}
+
+// Return the number of bytes at the front of the view that are valid
+// UTF-8. If the whole view is valid, then this is the length of the view.
+int valid_utf8_prefix(StrView v) {
+
+    const unsigned char* buf = (const unsigned char*)v.ptr;
+    int i = 0;
+    int cp;
+
+    while(i < v.len) {
+        if(buf[i] < 0x80) {
+            i += ascii_block(&buf[i], v.len - i);
+            while(i < v.len && buf[i] < 0x80)
+                i++;
+        }
+        else {
+            int n = decode_utf8(&buf[i], v.len - i, &cp);
+            if(n == 0)
+                break;
+            i += n;
+        }
+    }
+
+    return i;
+}
+
+bool valid_utf8_view(StrView v) {
+
+    return valid_utf8_prefix(v) == v.len;
+}
+
+// Return the number of code points in the view. Invalid bytes that are not
+// continuation bytes are counted as one code point each, which is what the
+// iterator returns for them.
+int count_utf8_view(StrView v) {
+
+    const unsigned char* buf = (const unsigned char*)v.ptr;
+    int i;
+    int count = count_block(buf, v.len, &i);
+
+    for(; i < v.len; i++) {
+        if((buf[i] & 0xC0) != 0x80)
+            count++;
+    }
+
+    return count;
+}
+
+bool is_ascii_string(Str* str) {
+
+    return is_ascii_view(view_Str(str));
+}
+
+bool valid_utf8_string(Str* str) {
+
+    return valid_utf8_view(view_Str(str));
+}
+
+int count_utf8_string(Str* str) {
+
+    return count_utf8_view(view_Str(str));
+}
+
+Utf8Iter* init_utf8_iterator(StrView v) {
+
+    Utf8Iter* iter = _ALLOC_T(Utf8Iter);
+    iter->text = v;
+    iter->index = 0;
+
+    return iter;
+}
+
+// Return the next code point in cp. A byte that is not valid UTF-8 is
+// returned as U+FFFD and skipped. Returns false when there are no more.
+bool iterate_utf8(Utf8Iter* iter, int* cp) {
+
+    if(iter->index >= iter->text.len)
+        return false;
+
+    const unsigned char* buf = (const unsigned char*)&iter->text.ptr[iter->index];
+    if(buf[0] < 0x80) {
+        *cp = buf[0];
+        iter->index++;
+        return true;
+    }
+
+    int n = decode_utf8(buf, iter->text.len - iter->index, cp);
+    if(n == 0) {
+        *cp = UTF8_REPLACEMENT;
+        n = 1;
+    }
+    iter->index += n;
+
+    return true;
+}
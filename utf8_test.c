@@ -0,0 +1,56 @@
+
+#include "util.h"
+
+void check(const char* label, const char* text, int len) {
+
+    StrView v = view_bytes(text, len);
+    printf("%s: ascii: %d valid: %d prefix: %d bytes: %d code points: %d\n", label,
+           is_ascii_view(v), valid_utf8_view(v), valid_utf8_prefix(v), v.len, count_utf8_view(v));
+}
+
+int main() {
+
+    printf("validate and count\n");
+    check("ascii", "plain text that is longer than one block of sixteen", 51);
+    check("mixed", "na\xc3\xafve caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80 and more text here", 40);
+    check("overlong", "abc\xc0\xaf", 5);
+    check("surrogate", "abc\xed\xa0\x80", 6);
+    check("too big", "abc\xf4\x90\x80\x80", 7);
+    check("cut off", "abc\xe2\x82", 5);
+    check("stray", "abcdefghijklmnopqrstuvwxyz\x80", 27);
+
+    printf("\niterate code points\n");
+    Str* s = create_string("a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\xff!");
+    printf("string: ascii: %d valid: %d count: %d\n", is_ascii_string(s), valid_utf8_string(s),
+           count_utf8_string(s));
+    Utf8Iter* iter = init_utf8_iterator(view_Str(s));
+    int cp;
+    while(iterate_utf8(iter, &cp))
+        printf("U+%04X ", cp);
+    printf("\n");
+
+    printf("\nfile input\n");
+    const char* fname = "utf8_test.txt";
+    FPTR fp = open_output_file(fname);
+    emit_str(fp, "ab\xc3\xa9\xe2\x82\xac" "cd\n\xf0\x9f\x98\x80x\n");
+    close_output_file(fp);
+    printf("valid file: %d\n", valid_utf8_file(fname));
+
+    for(int mode = 0; mode < 2; mode++) {
+        set_utf8_columns(mode);
+        push_input_file(fname);
+        printf("%s columns:", mode ? "code point" : "byte");
+        while(get_char() != END_OF_FILE) {
+            if(get_char() == 'c' || get_char() == 'x')
+                printf(" %c at %d:%d", get_char(), get_line_no(), get_col_no());
+            consume_char();
+        }
+        printf("\n");
+        pop_input_file();
+    }
+    remove(fname);
+
+    destroy_string(s);
+
+    return 0;
+}
@@ -13,6 +13,9 @@
 #include <assert.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 //----------------------------------------------
 // mem.c
@@ -59,6 +62,8 @@ typedef struct {
 List* create_list(int size);
 void destroy_list(List* lst);
 void append_list(List* lst, void* data);
+void reserve_list(List* lst, int count);
+void extend_list(List* lst, void* data, int count);
 void read_list(List* lst, int index, void* data);
 void write_list(List* lst, int index, void* data);
 void insert_list(List* lst, int index, void* data);
@@ -80,6 +85,150 @@ int riterate_list(ListIter* iter, void* data);
 void* raw_list(List* lst);
 int length_list(List* lst);
 
+//------------------------------------------------------
+// collist.c
+//------------------------------------------------------
+// Column list. Records are stored as a structure of arrays
+// where every field has its own List. A schema is an array
+// of ColField that describes where each field lives in the
+// record that is passed to append/read/write.
+typedef struct {
+    int offset; // byte offset of the field in the record
+    int size;   // number of bytes in the field
+} ColField;
+
+// Build a schema entry from a struct type and a member name.
+#define COL_FIELD(t, f) { (int)offsetof(t, f), (int)sizeof(((t*)0)->f) }
+
+typedef struct {
+    List** cols;      // one list per field
+    ColField* fields; // copy of the schema
+    int ncols;        // number of fields in the schema
+} ColList;
+
+ColList* create_col_list(const ColField* fields, int count);
+void destroy_col_list(ColList* lst);
+void append_col_list(ColList* lst, void* record);
+void read_col_list(ColList* lst, int index, void* record);
+void write_col_list(ColList* lst, int index, void* record);
+void delete_col_list(ColList* lst, int index);
+void clear_col_list(ColList* lst);
+void read_col_field(ColList* lst, int index, int col, void* data);
+void write_col_field(ColList* lst, int index, int col, void* data);
+void* raw_col_list(ColList* lst, int col);
+int length_col_list(ColList* lst);
+
+//------------------------------------------------------
+// intlist.c
+//------------------------------------------------------
+// Compressed list of 64 bit integers. Values are stored in
+// blocks as delta encoded, bit packed integers. The list
+// is append only.
+#define INT_LIST_BLOCK 128
+
+typedef struct {
+    List* blocks;                 // headers of the sealed blocks
+    List* data;                   // packed words of the sealed blocks
+    int64_t tail[INT_LIST_BLOCK]; // open block, not packed yet
+    int tail_len;                 // number of values in the open block
+    int count;                    // total number of values
+} IntList;
+
+typedef struct {
+    IntList* list;               // list to iterate
+    int index;                   // index of the next value
+    int block;                   // block that is decoded in buf
+    int avail;                   // number of values decoded in buf
+    int64_t buf[INT_LIST_BLOCK]; // decoded values
+} IntListIter;
+
+IntList* create_int_list();
+void destroy_int_list(IntList* lst);
+void append_int_list(IntList* lst, int64_t value);
+void clear_int_list(IntList* lst);
+int64_t read_int_list(IntList* lst, int index);
+int decode_int_list(IntList* lst, int block, int64_t* out);
+int blocks_int_list(IntList* lst);
+int length_int_list(IntList* lst);
+size_t bytes_int_list(IntList* lst);
+IntListIter* init_int_list_iterator(IntList* lst);
+int iterate_int_list(IntListIter* iter, int64_t* value);
+
+//------------------------------------------------------
+// slotmap.c
+//------------------------------------------------------
+// Slot map. Items are stored densely and are referred to
+// by a handle that stays valid until the item is erased.
+// A handle to an erased item is detected as stale. Zero
+// is never a valid handle.
+typedef uint64_t SlotHandle;
+
+typedef struct {
+    List* data;         // dense list of items
+    List* owners;       // slot index of every item in the dense list
+    List* slots;        // indirection from handles to the dense list
+    uint32_t free_head; // first free slot
+} SlotMap;
+
+SlotMap* create_slot_map(int size);
+void destroy_slot_map(SlotMap* map);
+SlotHandle insert_slot_map(SlotMap* map, void* data);
+bool erase_slot_map(SlotMap* map, SlotHandle h);
+void* lookup_slot_map(SlotMap* map, SlotHandle h);
+bool read_slot_map(SlotMap* map, SlotHandle h, void* data);
+bool write_slot_map(SlotMap* map, SlotHandle h, void* data);
+bool valid_slot_map(SlotMap* map, SlotHandle h);
+SlotHandle handle_slot_map(SlotMap* map, int index);
+void clear_slot_map(SlotMap* map);
+void* raw_slot_map(SlotMap* map);
+int length_slot_map(SlotMap* map);
+
+//------------------------------------------------------
+// snaplist.c
+//------------------------------------------------------
+// Copy-on-write list for read mostly data that is shared
+// between threads. Writers publish a new immutable version
+// and readers take a snapshot of the current version
+// without locking.
+#define SNAP_READERS 64 // max number of snapshots held at once
+
+typedef struct _snap_version_ {
+    struct _snap_version_* next; // link in the retired list
+    uint64_t retired;            // epoch when this version was replaced
+    int len;                     // number of items
+    int size;                    // number of bytes that each item uses
+    unsigned char buffer[];      // the items
+} SnapVersion;
+
+typedef struct {
+    _Atomic(SnapVersion*) current;           // published version
+    _Atomic(uint64_t) epoch;                 // advanced by every publish
+    _Atomic(uint64_t) readers[SNAP_READERS]; // epoch of every active reader
+    SnapVersion* retired;                    // versions waiting to be freed
+    int size;                                // number of bytes in an item
+    pthread_mutex_t lock;                    // serializes the writers
+} SnapList;
+
+// A snapshot is owned by the reader, usually on the stack.
+typedef struct {
+    SnapList* list;       // list the snapshot was taken from
+    SnapVersion* version; // version that is being read
+    int slot;             // reader slot that holds the epoch
+} SnapShot;
+
+SnapList* create_snap_list(int size);
+void destroy_snap_list(SnapList* lst);
+void append_snap_list(SnapList* lst, void* data);
+void write_snap_list(SnapList* lst, int index, void* data);
+void delete_snap_list(SnapList* lst, int index);
+void clear_snap_list(SnapList* lst);
+void publish_snap_list(SnapList* lst, List* src);
+void take_snap_list(SnapList* lst, SnapShot* snap);
+void release_snap_list(SnapShot* snap);
+void read_snapshot(SnapShot* snap, int index, void* data);
+void* raw_snapshot(SnapShot* snap);
+int length_snapshot(SnapShot* snap);
+
 //------------------------------------------------------
 // ptrlst.c
 //------------------------------------------------------
@@ -133,8 +282,24 @@ static inline void* pop_ptr_list(PtrList* h) {
 // Specialize the ptr list to be a str list.
 typedef List StrList;
 typedef ListIter StrListIter;
-typedef List Str;
-typedef ListIter StrIter;
+
+// Strings that fit in the small buffer, including the terminator, are kept
+// inside of the Str and do not need a separate allocation. The size makes
+// the Str 48 bytes.
+#define STR_SMALL_SIZE 28
+
+typedef struct {
+    char* buffer;               // points to small or to the heap
+    int len;                    // number of characters, not counting the '\0'
+    int cap;                    // number of bytes in the buffer
+    uint32_t hash;              // hash_bytes() of the characters or 0 if not known
+    char small[STR_SMALL_SIZE]; // buffer for short strings
+} Str;
+
+typedef struct {
+    Str* str;  // string to iterate
+    int index; // index of the next character
+} StrIter;
 
 Str* join_string_list(StrList* lst, const char* str);
 Str* copy_string(Str* str);
@@ -144,6 +309,9 @@ void destroy_string(Str* ptr);
 void add_string_char(Str* ptr, int ch);
 void add_string_str(Str* ptr, const char* str);
 void add_string_fmt(Str* ptr, const char* str, ...);
+void add_string_vfmt(Str* ptr, const char* str, va_list args);
+void add_string_bytes(Str* ptr, const void* buf, int len);
+void reserve_string(Str* ptr, int len);
 
 StrIter* init_string_iterator(Str* ptr);
 int iterate_string(StrIter* ptr);
@@ -159,11 +327,22 @@ int comp_string_const(Str* s1, const char* s2);
 void truncate_string(Str* str, int index);
 void clear_string(Str* str);
 int length_string(Str* str);
+uint32_t hash_string(Str* str);
 void add_string_Str(Str* ptr, Str* str);
 void print_string(FILE* fp, Str* str);
 void printf_string(FILE* fp, Str* str, ...);
 Str* upcase_string(Str* str);
 Str* downcase_string(Str* str);
+void upcase_string_inplace(Str* str);
+void downcase_string_inplace(Str* str);
+int comp_string_nocase(Str* s1, Str* s2);
+int comp_string_const_nocase(Str* s1, const char* s2);
+int find_string(Str* str, const char* needle);
+int rfind_string(Str* str, const char* needle);
+int find_any_string(Str* str, const char* set);
+int count_string(Str* str, const char* needle);
+Str* replace_string(Str* str, const char* old, const char* new);
+StrList* split_string(Str* str, const char* sep);
 
 
 // TODO: Swap, sort, and find to be implemented mostly in the list functions
@@ -208,40 +387,407 @@ static inline Str* pop_string_list(StrList* lst) {
     return val;
 }
 
+//--------------------------------------------------------
+// strview.c
+//--------------------------------------------------------
+// A view is a pointer and a length that refers to characters that are
+// owned by something else. Views are not '\0' terminated. Print them
+// with "%.*s", v.len, v.ptr.
+typedef struct {
+    const char* ptr; // first character
+    int len;         // number of characters
+} StrView;
+
+StrView view_bytes(const char* ptr, int len);
+StrView view_str(const char* str);
+StrView view_Str(Str* str);
+StrView sub_view(StrView v, int start, int len);
+StrView ltrim_view(StrView v);
+StrView rtrim_view(StrView v);
+StrView trim_view(StrView v);
+int find_char_view(StrView v, int ch);
+int find_view(StrView v, StrView needle);
+int rfind_view(StrView v, StrView needle);
+int find_any_view(StrView v, StrView set);
+int count_view(StrView v, StrView needle);
+int comp_view(StrView s1, StrView s2);
+bool equal_view(StrView s1, StrView s2);
+int comp_view_nocase(StrView s1, StrView s2);
+bool equal_view_nocase(StrView s1, StrView s2);
+bool starts_with_view(StrView v, StrView prefix);
+bool ends_with_view(StrView v, StrView suffix);
+bool next_view(StrView* rest, int sep, StrView* field);
+int split_view(StrView v, int sep, List* out);
+Str* create_string_view(StrView v);
+void add_string_view(Str* ptr, StrView v);
+
+//--------------------------------------------------------
+// rope.c
+//--------------------------------------------------------
+// Text that is made of a balanced tree of chunks, for large
+// text that is edited in the middle. Insert, delete and index
+// are O(log n).
+#define ROPE_CHUNK 256 // max number of characters in a chunk
+
+typedef struct {
+    struct _rope_node_* root; // tree of chunks
+    uint32_t seed;            // state for the node priorities
+} Rope;
+
+typedef struct {
+    PtrList* stack; // nodes that still have to be visited
+} RopeIter;
+
+Rope* create_rope(const char* str);
+void destroy_rope(Rope* rope);
+int length_rope(Rope* rope);
+int char_rope(Rope* rope, int index);
+void insert_rope_bytes(Rope* rope, int index, const char* text, int len);
+void insert_rope_str(Rope* rope, int index, const char* str);
+void append_rope(Rope* rope, const char* text, int len);
+void delete_rope(Rope* rope, int index, int len);
+void concat_rope(Rope* dest, Rope* src);
+Str* flatten_rope(Rope* rope);
+RopeIter* init_rope_iterator(Rope* rope);
+bool iterate_rope(RopeIter* iter, StrView* chunk);
+
+//-----------------------------------------------------------------
+// utf8.c
+//-----------------------------------------------------------------
+// Look at the bytes of a string or view as UTF-8.
+#define UTF8_REPLACEMENT 0xFFFD // returned for bytes that are not valid
+
+typedef struct {
+    StrView text; // the text being decoded
+    int index;    // byte index of the next code point
+} Utf8Iter;
+
+int length_utf8_char(int ch);
+bool is_ascii_view(StrView v);
+int valid_utf8_prefix(StrView v);
+bool valid_utf8_view(StrView v);
+int count_utf8_view(StrView v);
+bool is_ascii_string(Str* str);
+bool valid_utf8_string(Str* str);
+int count_utf8_string(Str* str);
+Utf8Iter* init_utf8_iterator(StrView v);
+bool iterate_utf8(Utf8Iter* iter, int* cp);
+
+//-----------------------------------------------------------------
+// number.c
+//-----------------------------------------------------------------
+// Numbers to and from text without printf() or scanf().
+typedef enum {
+    NUM_OK,      // the number was read
+    NUM_EMPTY,   // there are no digits
+    NUM_INVALID, // a character is not part of the number
+    NUM_RANGE,   // the number does not fit in the type
+} NumResult;
+
+void add_string_int(Str* ptr, long val);
+void add_string_uint(Str* ptr, unsigned long val);
+void add_string_hex(Str* ptr, unsigned long val);
+void add_string_double(Str* ptr, double val);
+NumResult parse_int_view(StrView v, int base, long* val);
+NumResult parse_uint_view(StrView v, int base, unsigned long* val);
+NumResult parse_double_view(StrView v, double* val);
+
 //-----------------------------------------------------------------
 // hash.c
 //-----------------------------------------------------------------
 
+// Number of control bytes that are probed at one time.
+#define HASH_GROUP 16
+
+// Largest value that HASH_STORE_INLINE can keep in the entry.
+#define HASH_INLINE_SIZE sizeof(void*)
+
+// Flags are a bitmask that is given to create_hashtable_flags(). The store
+// flags select how the data is kept. Only one of them can be used.
+// HASH_KEY_INT makes a table with integer or pointer keys, which use the
+// _u64 and _ptr functions. HASH_KEY_BORROW keeps the pointer to a string key
+// instead of a copy, so the key must not change or be freed while it is in
+// the table. HASH_SEED gives the table a random seed of its own, and the
+// string keys are hashed with it. The hash that a Str keeps or that is given
+// to the _hashed functions is made with the seed for the run, so such a table
+// does not use it and hashes the key again.
+// HASH_ORDERED keeps the entries in the order they were added. Such a table
+// is not resized a few buckets at a time. Its buckets are made again all at
+// once when it fills, so one insert can take time in proportion to the
+// number of entries.
+typedef enum {
+    HASH_STORE_COPY = 0x00,   // copy the data into the table (default)
+    HASH_STORE_PTR = 0x01,    // keep the data pointer, the data is not copied
+    HASH_STORE_INLINE = 0x02, // copy up to HASH_INLINE_SIZE bytes into the entry
+    HASH_KEY_INT = 0x04,      // the keys are integers, not strings
+    HASH_SEED = 0x08,         // hash the keys with a seed for this table
+    HASH_ORDERED = 0x10,      // iterate in the order that the keys were added
+    HASH_KEY_BORROW = 0x20,   // keep the key pointer, the key is not copied
+} HashFlag;
+
+#define HASH_STORE_MASK 0x03
+
 typedef struct {
-    const char* key;
-    void* data;
-    size_t size;
-} _hash_node;
+    union {
+        const char* key; // copy of the key, a copy of the data goes after it
+        uint64_t num;    // the key for HASH_KEY_INT
+    };
+    union {
+        void* data;                            // the copy of the data, the pointer, or NULL
+        unsigned char value[HASH_INLINE_SIZE]; // the data for HASH_STORE_INLINE
+    };
+    size_t size;   // size of the data
+    uint32_t len;  // length of the key
+    uint32_t hash; // hash of the key
+} _hash_entry;
+
+// Number of old buckets that are moved to the new ones by every insert and
+// remove while the table is being resized.
+#define HASH_MIGRATE (HASH_GROUP * 2)
 
 /*
- * If a node's key is NULL, but the bucket pointer in the table
- * is not NULL, then the bucket is a tombstone.
+ * The entries are stored in the buckets. There is a control byte for every
+ * entry that tells if it is empty, deleted or has part of the hash.
  */
 typedef struct {
-    _hash_node** table;
-    int cap;
-    int count;
-    int tombstones;
+    uint8_t* ctrl;        // cap control bytes, then a copy of the first HASH_GROUP
+    _hash_entry* entries; // cap entries, or NULL for HASH_ORDERED
+    int32_t* index;       // for HASH_ORDERED, the place of the entry in the list
+    int cap;              // number of buckets, a power of 2
+} _hash_buckets;
+
+/*
+ * While the table is being resized, the entries are in both sets of
+ * buckets. The old buckets are NULL when it is not.
+ */
+typedef struct {
+    _hash_buckets cur; // new entries go here
+    _hash_buckets old; // entries that are still being moved to cur
+    int migrate;       // next bucket in old to move
+    int old_count;     // number of entries still in old
+    int count;         // number of entries in both
+    int tombstones;    // number of deleted entries in cur
+    HashFlag flags;    // how the data is stored
+    uint64_t seed;     // mixed into the hashes of the keys
+    List* order;       // for HASH_ORDERED, the entries in the order they were added
 } HashTable;
 
+typedef struct {
+    HashTable* table; // table to iterate
+    int index;        // next bucket or list entry to look at
+    bool old;         // true when looking at the old buckets
+    const char* key;  // key of the current entry, NULL for HASH_KEY_INT
+    size_t len;       // length of the key
+    uint64_t num;     // key of the current entry for HASH_KEY_INT
+    void* value;      // what lookup_hashtable() returns for the key
+} HashIter;
+
+// Number of counts in the histogram of probe lengths. The last one counts
+// the keys that look at that many groups or more.
+#define HASH_PROBE_HIST 5
+
+typedef struct {
+    int keys;                  // number of entries that were looked up
+    long groups;               // groups that were looked at for all of them
+    int most;                  // most groups for one entry
+    int hist[HASH_PROBE_HIST]; // entries that looked at 1, 2, ... groups
+    int cap;                   // number of buckets
+} HashProbeStats;
+
 typedef enum {
     HASH_OK,
     HASH_DUP,
     HASH_NF,
+    HASH_SIZE,
 } HashResult;
 
-// TODO: use the list functions for the table. That means that the list needs to
-// be able to handle NULL pointers.
 HashTable* create_hashtable();
+HashTable* create_hashtable_flags(HashFlag flags);
 void destroy_hashtable(HashTable* table);
+HashIter* init_hashtable_iterator(HashTable* tab);
+bool iterate_hashtable(HashIter* iter);
+void probe_stats_hashtable(HashTable* tab, HashProbeStats* stats);
 HashResult insert_hashtable(HashTable* table, const char* key, void* data, size_t size);
 HashResult find_hashtable(HashTable* tab, const char* key, void* data, size_t size);
 HashResult remove_hashtable(HashTable* tab, const char* key);
+HashResult insert_hashtable_view(HashTable* table, StrView key, void* data, size_t size);
+HashResult find_hashtable_view(HashTable* tab, StrView key, void* data, size_t size);
+HashResult remove_hashtable_view(HashTable* tab, StrView key);
+HashResult insert_hashtable_Str(HashTable* table, Str* key, void* data, size_t size);
+HashResult find_hashtable_Str(HashTable* tab, Str* key, void* data, size_t size);
+HashResult remove_hashtable_Str(HashTable* tab, Str* key);
+void* lookup_hashtable(HashTable* tab, const char* key);
+void* lookup_hashtable_view(HashTable* tab, StrView key);
+void* lookup_hashtable_Str(HashTable* tab, Str* key);
+HashResult upsert_hashtable(HashTable* table, const char* key, void* data, size_t size, void** value);
+HashResult upsert_hashtable_view(HashTable* table, StrView key, void* data, size_t size, void** value);
+HashResult upsert_hashtable_Str(HashTable* table, Str* key, void* data, size_t size, void** value);
+HashResult insert_hashtable_hashed(HashTable* table, const char* key, size_t len, uint32_t hash,
+                                   void* data, size_t size);
+HashResult find_hashtable_hashed(HashTable* tab, const char* key, size_t len, uint32_t hash,
+                                 void* data, size_t size);
+HashResult remove_hashtable_hashed(HashTable* tab, const char* key, size_t len, uint32_t hash);
+void* lookup_hashtable_hashed(HashTable* tab, const char* key, size_t len, uint32_t hash);
+HashResult upsert_hashtable_hashed(HashTable* table, const char* key, size_t len, uint32_t hash,
+                                   void* data, size_t size, void** value);
+HashResult insert_hashtable_bytes(HashTable* table, const void* key, size_t len, void* data,
+                                  size_t size);
+HashResult find_hashtable_bytes(HashTable* tab, const void* key, size_t len, void* data,
+                                size_t size);
+HashResult remove_hashtable_bytes(HashTable* tab, const void* key, size_t len);
+void* lookup_hashtable_bytes(HashTable* tab, const void* key, size_t len);
+HashResult upsert_hashtable_bytes(HashTable* table, const void* key, size_t len, void* data,
+                                  size_t size, void** value);
+HashResult insert_hashtable_u64(HashTable* table, uint64_t key, void* data, size_t size);
+HashResult find_hashtable_u64(HashTable* tab, uint64_t key, void* data, size_t size);
+HashResult remove_hashtable_u64(HashTable* tab, uint64_t key);
+void* lookup_hashtable_u64(HashTable* tab, uint64_t key);
+HashResult upsert_hashtable_u64(HashTable* table, uint64_t key, void* data, size_t size,
+                                void** value);
+HashResult insert_hashtable_ptr(HashTable* table, const void* key, void* data, size_t size);
+HashResult find_hashtable_ptr(HashTable* tab, const void* key, void* data, size_t size);
+HashResult remove_hashtable_ptr(HashTable* tab, const void* key);
+void* lookup_hashtable_ptr(HashTable* tab, const void* key);
+HashResult upsert_hashtable_ptr(HashTable* table, const void* key, void* data, size_t size,
+                                void** value);
+uint32_t hash_bytes(const void* key, size_t len);
+uint32_t hash_bytes_nocase(const void* key, size_t len);
+uint64_t hash_bytes64(const void* key, size_t len, uint64_t seed);
+void set_hash_seed(uint64_t seed);
+uint64_t get_hash_seed(void);
+
+//-----------------------------------------------------------------
+// chash.c
+//-----------------------------------------------------------------
+// Hash table of strings to pointers that is shared between threads.
+// Readers do not lock, writers lock one stripe of the buckets and
+// the table grows while it is in use.
+#define CHASH_STRIPES 64  // number of writer locks, a power of 2
+#define CHASH_READERS 128 // max number of operations at once
+#define CHASH_MIGRATE 16  // buckets that a writer moves while resizing
+#define CHASH_RECLAIM 64  // retired items in a stripe before freeing
+
+typedef struct _chash_garbage_ {
+    struct _chash_garbage_* next; // link in the retired list
+    uint64_t retired;             // epoch when it was retired
+} _chash_garbage;
+
+typedef struct _chash_node_ {
+    _chash_garbage garbage;             // must be first
+    _Atomic(struct _chash_node_*) next; // next node in the bucket
+    void* value;                        // the value, as given
+    uint32_t hash;                      // hash of the key
+    uint32_t len;                       // length of the key
+    char key[];                         // the key, terminated
+} _chash_node;
+
+typedef struct _chash_array_ {
+    _chash_garbage garbage;              // must be first
+    _Atomic(struct _chash_array_*) next; // array that this is moving to
+    atomic_int migrate;                  // next bucket to move
+    atomic_int moved;                    // number of buckets moved
+    int cap;                             // number of buckets
+    _Atomic(_chash_node*) buckets[];     // the chains
+} _chash_array;
+
+typedef struct {
+    pthread_mutex_t lock;    // serializes the writers of the stripe
+    atomic_int count;        // number of keys in the stripe
+    _chash_garbage* retired; // nodes and arrays waiting to be freed
+    int nretired;            // number of retired items
+    char pad[64];            // keeps stripes off each other's cache line
+} _chash_stripe;
+
+typedef struct {
+    _Atomic(uint64_t) epoch; // epoch of the operation, or 0 if free
+    char pad[56];            // one slot per cache line
+} _chash_reader;
+
+typedef struct {
+    _Atomic(_chash_array*) array;         // current array of buckets
+    _Atomic(uint64_t) epoch;              // advanced by every retire
+    _chash_stripe stripes[CHASH_STRIPES]; // writer locks
+    _chash_reader readers[CHASH_READERS]; // epoch of every active operation
+} CHashTable;
+
+CHashTable* create_chashtable();
+void destroy_chashtable(CHashTable* tab);
+HashResult insert_chashtable(CHashTable* tab, const char* key, void* value);
+HashResult find_chashtable(CHashTable* tab, const char* key, void** value);
+HashResult remove_chashtable(CHashTable* tab, const char* key);
+HashResult insert_chashtable_view(CHashTable* tab, StrView key, void* value);
+HashResult find_chashtable_view(CHashTable* tab, StrView key, void** value);
+HashResult remove_chashtable_view(CHashTable* tab, StrView key);
+int count_chashtable(CHashTable* tab);
+
+//-----------------------------------------------------------------
+// perfect.c
+//-----------------------------------------------------------------
+// Minimal perfect hash of a fixed set of keys, such as keywords or
+// command line options. Every key has its own slot, so a lookup is
+// one hash, one displacement and one compare. The table can also be
+// written out as a C header that is built into a program.
+#define PERFECT_LAMBDA 4        // average number of keys in a bucket
+#define PERFECT_TRIES (1 << 20) // displacements tried for a bucket
+#define PERFECT_SEEDS 32        // seeds tried before giving up
+
+typedef struct {
+    uint32_t* disp;    // displacement of every bucket
+    const char** keys; // key in every slot
+    uint32_t* lens;    // length of the key in every slot
+    int* index;        // index of the key in the list it was built from
+    char* pool;        // the characters of the keys
+    uint64_t seed;     // seed of the hash
+    int count;         // number of keys and of slots
+    int nbuckets;      // number of buckets
+} PerfectHash;
+
+// The slot for the hash of a key. The key in the slot still has to be
+// compared. Tables that are written by emit_perfect_hash() use this too.
+static inline uint32_t perfect_hash_slot(uint64_t hash,
+                                         const uint32_t* disp,
+                                         uint32_t nbuckets,
+                                         uint32_t count) {
+    uint32_t bucket = (uint32_t)(((hash >> 32) * nbuckets) >> 32);
+    uint32_t step = (uint32_t)((hash * 0x9E3779B97F4A7C15ull) >> 32) | 1;
+    uint32_t pos = (uint32_t)hash + disp[bucket] * step;
+    return (uint32_t)(((uint64_t)pos * count) >> 32);
+}
+
+PerfectHash* create_perfect_hash(const char** keys, int count);
+PerfectHash* create_perfect_hash_views(const StrView* keys, int count);
+void destroy_perfect_hash(PerfectHash* ph);
+int find_perfect_hash(PerfectHash* ph, const char* key);
+int find_perfect_hash_view(PerfectHash* ph, StrView key);
+void emit_perfect_hash(PerfectHash* ph, FILE* fp, const char* name);
+
+//-----------------------------------------------------------------
+// intern.c
+//-----------------------------------------------------------------
+// Interned strings. A table stores every distinct string once, so
+// atoms from the same table can be compared by pointer. Atoms are
+// never changed and live until the table is destroyed.
+typedef struct {
+    const char* str; // the characters, '\0' terminated
+    int len;         // number of characters
+    uint32_t hash;   // hash_bytes() of the characters
+} Atom;
+
+typedef struct {
+    HashTable* table;     // maps the characters to the atom
+    PtrList* chunks;      // arena chunks
+    unsigned char* chunk; // chunk that is being allocated from
+    size_t used;          // bytes used in the current chunk
+    size_t avail;         // size of the current chunk
+    int count;            // number of atoms
+} InternTable;
+
+InternTable* create_intern_table();
+void destroy_intern_table(InternTable* tab);
+const Atom* intern_str(InternTable* tab, const char* str);
+const Atom* intern_Str(InternTable* tab, Str* str);
+const Atom* find_intern_str(InternTable* tab, const char* str);
+int length_intern_table(InternTable* tab);
 
 //-------------------------------------------------------------
 // fileio.c
@@ -257,6 +803,8 @@ int consume_char();
 int get_line_no();
 int get_col_no();
 const char* get_fname();
+void set_utf8_columns(bool flag);
+bool valid_utf8_file(const char* fname);
 
 // Since multiple output files can be open in a moment, then it is accessed
 // using an opaque handle.
@@ -268,6 +816,7 @@ void emit_buf(FPTR h, void* buf, unsigned int size);
 void emit_fmt(FPTR h, const char* fmt, ...);
 void emit_Str(FPTR h, Str* str);
 void emit_str(FPTR h, const char* str);
+void emit_view(FPTR h, StrView str);
 
 //-------------------------------------------------------------
 // cmd.c